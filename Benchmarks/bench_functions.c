@@ -0,0 +1,262 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include "bench_functions.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+void bench_series_init(bench_series* series)
+{
+	series->values = NULL;
+	series->count = 0;
+	series->capacity = 0;
+}
+
+void bench_series_add(bench_series* series, double value)
+{
+	if(series->count == series->capacity)
+	{
+		series->capacity = series->capacity ? 2*series->capacity : 64;
+		series->values = realloc(series->values, series->capacity*sizeof(double));
+		
+		if(series->values == NULL)
+		{
+			printf("Memory Allocation Failure!");
+			exit(2);
+		}
+	}
+	
+	series->values[series->count++] = value;
+}
+
+void bench_series_free(bench_series* series)
+{
+	free(series->values);
+	bench_series_init(series);
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	
+	return (x > y) - (x < y);
+}
+
+// nearest-rank percentile of sorted values
+static double percentile(const double* sorted, int count, double p)
+{
+	int rank = (int)(p*count + 0.999999);
+	
+	if(rank < 1)
+		rank = 1;
+	if(rank > count)
+		rank = count;
+	
+	return sorted[rank-1];
+}
+
+bench_summary bench_summarize(const bench_series* series)
+{
+	bench_summary s = {series->count, 0, 0, 0, 0, 0};
+	
+	if(series->count == 0)
+		return s;
+	
+	double* sorted = malloc(series->count*sizeof(double));
+	memcpy(sorted, series->values, series->count*sizeof(double));
+	qsort(sorted, series->count, sizeof(double), compare_doubles);
+	
+	for(int i=0; i<series->count; i++)
+		s.mean += sorted[i];
+	
+	s.mean /= series->count;
+	s.median = percentile(sorted, series->count, 0.5);
+	s.p90 = percentile(sorted, series->count, 0.9);
+	s.p99 = percentile(sorted, series->count, 0.99);
+	s.max = sorted[series->count-1];
+	
+	free(sorted);
+	
+	return s;
+}
+
+unsigned long long bench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return bench_ns();
+#endif
+}
+
+unsigned long long bench_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+const char* bench_perf_names[BENCH_PERF_COUNTERS] = {"cycles", "instructions", "cache_misses"};
+
+// opens the counters of the calling thread, user space only; returns false if the kernel does not allow it
+bool bench_perf_open(bench_perf* perf)
+{
+	perf->open = false;
+	
+#ifdef __linux__
+	static const unsigned long long config[BENCH_PERF_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+	
+	for(int c=0; c<BENCH_PERF_COUNTERS; c++)
+	{
+		struct perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = config[c];
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		
+		perf->fd[c] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+		
+		if(perf->fd[c] < 0)
+		{
+			for(int o=0; o<c; o++)
+				close(perf->fd[o]);
+			
+			return false;
+		}
+	}
+	
+	perf->open = true;
+#endif
+	
+	return perf->open;
+}
+
+void bench_perf_start(bench_perf* perf)
+{
+#ifdef __linux__
+	if(!perf->open)
+		return;
+	
+	for(int c=0; c<BENCH_PERF_COUNTERS; c++)
+	{
+		ioctl(perf->fd[c], PERF_EVENT_IOC_RESET, 0);
+		ioctl(perf->fd[c], PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+void bench_perf_stop(bench_perf* perf, unsigned long long counts[BENCH_PERF_COUNTERS])
+{
+	for(int c=0; c<BENCH_PERF_COUNTERS; c++)
+		counts[c] = 0;
+	
+#ifdef __linux__
+	if(!perf->open)
+		return;
+	
+	for(int c=0; c<BENCH_PERF_COUNTERS; c++)
+		ioctl(perf->fd[c], PERF_EVENT_IOC_DISABLE, 0);
+	
+	for(int c=0; c<BENCH_PERF_COUNTERS; c++)
+		if(read(perf->fd[c], &counts[c], sizeof(counts[c])) != sizeof(counts[c]))
+			counts[c] = 0;
+#endif
+}
+
+void bench_perf_close(bench_perf* perf)
+{
+#ifdef __linux__
+	if(perf->open)
+		for(int c=0; c<BENCH_PERF_COUNTERS; c++)
+			close(perf->fd[c]);
+#endif
+	
+	perf->open = false;
+}
+
+void bench_op_init(bench_op* op, const char* name, int size)
+{
+	op->name = name;
+	op->size = size;
+	bench_series_init(&op->cycles);
+	bench_series_init(&op->ns);
+	
+	for(int c=0; c<BENCH_PERF_COUNTERS; c++)
+		bench_series_init(&op->perf[c]);
+}
+
+void bench_op_free(bench_op* op)
+{
+	bench_series_free(&op->cycles);
+	bench_series_free(&op->ns);
+	
+	for(int c=0; c<BENCH_PERF_COUNTERS; c++)
+		bench_series_free(&op->perf[c]);
+}
+
+static void print_summary(FILE* out, const char* label, bench_summary s)
+{
+	fprintf(out, "  %-13s median %12.0f  p90 %12.0f  p99 %12.0f  max %12.0f  mean %12.0f\n", label, s.median, s.p90, s.p99, s.max, s.mean);
+}
+
+void bench_op_print(FILE* out, const bench_op* op, bool perf)
+{
+	if(op->size >= 0)
+		fprintf(out, "%s (%d byte messages, %d runs)\n", op->name, op->size, op->cycles.count);
+	else
+		fprintf(out, "%s (%d runs)\n", op->name, op->cycles.count);
+	
+	print_summary(out, "cycles", bench_summarize(&op->cycles));
+	print_summary(out, "ns", bench_summarize(&op->ns));
+	
+	if(perf)
+		for(int c=0; c<BENCH_PERF_COUNTERS; c++)
+			print_summary(out, bench_perf_names[c], bench_summarize(&op->perf[c]));
+}
+
+static void json_summary(FILE* out, const char* label, bench_summary s, bool last)
+{
+	fprintf(out, "      \"%s\": {\"median\": %.0f, \"p90\": %.0f, \"p99\": %.0f, \"max\": %.0f, \"mean\": %.1f}%s\n", label, s.median, s.p90, s.p99, s.max, s.mean, last ? "" : ",");
+}
+
+void bench_json_begin(FILE* out, const char* tool, const char* variant, int iterations)
+{
+	fprintf(out, "{\n  \"tool\": \"%s\",\n  \"variant\": \"%s\",\n  \"iterations\": %d,\n  \"operations\": [\n", tool, variant, iterations);
+}
+
+void bench_json_op(FILE* out, const bench_op* op, bool perf, bool first)
+{
+	fprintf(out, "%s    {\n      \"name\": \"%s\",\n      \"message_bytes\": %d,\n      \"runs\": %d,\n", first ? "" : ",\n", op->name, op->size, op->cycles.count);
+	json_summary(out, "cycles", bench_summarize(&op->cycles), false);
+	json_summary(out, "ns", bench_summarize(&op->ns), !perf);
+	
+	if(perf)
+		for(int c=0; c<BENCH_PERF_COUNTERS; c++)
+			json_summary(out, bench_perf_names[c], bench_summarize(&op->perf[c]), c == BENCH_PERF_COUNTERS-1);
+	
+	fprintf(out, "    }");
+}
+
+void bench_json_end(FILE* out)
+{
+	fprintf(out, "\n  ]\n}\n");
+}
@@ -0,0 +1,64 @@
+#ifndef bench_functions_h
+#define bench_functions_h
+
+#include <stdio.h>
+#include <stdbool.h>
+
+// samples of one measured quantity
+typedef struct {
+	double* values;
+	int count;
+	int capacity;
+} bench_series;
+
+typedef struct {
+	int count;
+	double mean;
+	double median;
+	double p90;
+	double p99;
+	double max;
+} bench_summary;
+
+void bench_series_init(bench_series* series);
+void bench_series_add(bench_series* series, double value);
+void bench_series_free(bench_series* series);
+bench_summary bench_summarize(const bench_series* series);
+
+unsigned long long bench_cycles(void);
+unsigned long long bench_ns(void);
+
+// hardware counters of the calling thread through perf_event_open
+#define BENCH_PERF_COUNTERS 3 // cycles, instructions, cache misses
+
+typedef struct {
+	int fd[BENCH_PERF_COUNTERS];
+	bool open;
+} bench_perf;
+
+extern const char* bench_perf_names[BENCH_PERF_COUNTERS];
+
+bool bench_perf_open(bench_perf* perf);
+void bench_perf_start(bench_perf* perf);
+void bench_perf_stop(bench_perf* perf, unsigned long long counts[BENCH_PERF_COUNTERS]);
+void bench_perf_close(bench_perf* perf);
+
+// measurements of one operation: cycles, wall time and, if enabled, the perf counters
+typedef struct {
+	const char* name;
+	int size;  // message size, or -1 if it does not apply
+	bench_series cycles;
+	bench_series ns;
+	bench_series perf[BENCH_PERF_COUNTERS];
+} bench_op;
+
+void bench_op_init(bench_op* op, const char* name, int size);
+void bench_op_free(bench_op* op);
+void bench_op_print(FILE* out, const bench_op* op, bool perf);
+
+// JSON report: bench_json_begin, then bench_json_op for each operation, then bench_json_end
+void bench_json_begin(FILE* out, const char* tool, const char* variant, int iterations);
+void bench_json_op(FILE* out, const bench_op* op, bool perf, bool first);
+void bench_json_end(FILE* out);
+
+#endif
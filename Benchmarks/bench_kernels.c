@@ -0,0 +1,702 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fnmatch.h>
+#include "parameters.h"
+#include "common_functions.h"
+#include "pack_functions.h"
+#include "soa_functions.h"
+#include "lht_functions.h"
+#include "rng_functions.h"
+#include "keccak.h"
+#include "aes.h"
+#include "bench_functions.h"
+
+// Per-call cost of the arithmetic, packing, hashing and DRBG kernels of the library.
+// Kernels are named <kernel>[/<implementation>]; every implementation of a kernel runs on the same inputs
+// and their outputs are compared, so scalar and SIMD code paths can be measured side by side.
+// Usage: bench_kernels_<variant> [-l] [-n samples] [-t ns per sample] [-w warmup] [-p] [-j report.json] [pattern ...]
+
+#ifndef BENCH_VARIANT
+#define BENCH_VARIANT "unknown"
+#endif
+
+#define MAX_MESSAGE 65536
+#define SHAKE_OUTPUT 64
+#define CTR_BLOCKS 64
+#define LANES 8 // instances of the _x8 kernels, as many as batch verification runs at once
+
+// inputs shared by every kernel, drawn once from a fixed seed
+static __int128 a_coeffs[N*N][M], b_coeffs[N*N][M], v_coeffs[N][M];
+static __int128* a_rows[N][N];
+static __int128* b_rows[N][N];
+static __int128** a_matrix[N];
+static __int128** b_matrix[N];
+static __int128* v_vector[N];
+
+static __int128 pk_coeffs[N*(N+1)/2][M], sk_coeffs[S*S][M], sig_coeffs[S][M], lht_coeffs[S*S][M];
+static __int128* pk_polys[N*(N+1)/2];
+static __int128* sk_polys[S*S];
+static __int128* sig_polys[S];
+static unsigned char pk_packed[1024], sk_packed[1024], sig_packed[1024];
+
+// LANES independent instances of z, as in batch verification, and the same inputs as soa polynomials
+// (see soa_functions.h); instance t of soa_a is a_coeffs[t]
+static __int128 lane_coeffs[LANES][N][M];
+static __int128* lane_z[LANES][N];
+static __int128* soa_a;
+static __int128** soa_z;
+static __int128** soa_out;
+static __int128* soa_zcz;
+
+static unsigned char message[MAX_MESSAGE];
+static unsigned char seed[48];
+static aes256_key aes_key;
+
+// outputs, compared between the implementations of a kernel
+static __int128 r_coeffs[N*N][M];
+static __int128* r_rows[N][N];
+static __int128** r_matrix[N];
+static unsigned char bytes_out[CTR_BLOCKS*16 > RNG_BUFFER_SIZE ? CTR_BLOCKS*16 : RNG_BUFFER_SIZE];
+static __int128 draws_out[M];
+static int int_out;
+static __int128 lane_out[LANES][N][M];
+static __int128* lane_out_rows[LANES][N];
+
+static rng_ctx rng;
+static AES256_CTR_DRBG_struct drbg;
+static unsigned char ctr[16];
+
+// coefficients uniform in (-bound, bound)
+static void draw_coeffs(rng_ctx* source, __int128* out, int n, int64_t bound)
+{
+	for(int k=0; k<n; k++)
+	{
+		uint64_t w;
+		rng_bytes_r(source, (unsigned char*)&w, sizeof(w));
+		out[k] = (int64_t)(w % (uint64_t)(2*bound - 1)) - (bound - 1);
+	}
+}
+
+static void setup_inputs(void)
+{
+	rng_ctx source;
+	unsigned char entropy[48];
+
+	for(int i=0; i<48; i++)
+		entropy[i] = i;
+
+	initialize_rng_r(&source, entropy, 48);
+
+	for(int i=0; i<N; i++)
+	{
+		for(int j=0; j<N; j++)
+		{
+			a_rows[i][j] = a_coeffs[i*N + j];
+			b_rows[i][j] = b_coeffs[i*N + j];
+			r_rows[i][j] = r_coeffs[i*N + j];
+			rngr_bulk_r(&source, DRB, RB, a_rows[i][j], M);
+			draw_coeffs(&source, b_rows[i][j], M, B22inv_BOUND);
+		}
+
+		a_matrix[i] = a_rows[i];
+		b_matrix[i] = b_rows[i];
+		r_matrix[i] = r_rows[i];
+		v_vector[i] = v_coeffs[i];
+		draw_coeffs(&source, v_vector[i], M, Y_BOUND);
+	}
+
+	int p = 0;
+	for(int b=0; b<3; b++)
+		for(int i=0; i<PK_LAYOUT[b].polys; i++, p++)
+		{
+			pk_polys[p] = pk_coeffs[p];
+			draw_coeffs(&source, pk_polys[p], M, PK_LAYOUT[b].bound);
+		}
+
+	for(int i=0; i<S*S; i++)
+	{
+		sk_polys[i] = sk_coeffs[i];
+		draw_coeffs(&source, sk_polys[i], M, SK_LAYOUT[0].bound);
+		draw_coeffs(&source, lht_coeffs[i], M, B22_BOUND);
+	}
+
+	for(int i=0; i<S; i++)
+	{
+		sig_polys[i] = sig_coeffs[i];
+		draw_coeffs(&source, sig_polys[i], M, SIG_LAYOUT[0].bound);
+	}
+
+	soa_a = allocate_soa_poly(LANES);
+	soa_z = allocate_soa_vector(N, LANES);
+	soa_out = allocate_soa_vector(N, LANES);
+	soa_zcz = allocate_soa_poly(LANES);
+
+	for(int t=0; t<LANES; t++)
+		for(int i=0; i<N; i++)
+		{
+			lane_z[t][i] = lane_coeffs[t][i];
+			lane_out_rows[t][i] = lane_out[t][i];
+			draw_coeffs(&source, lane_z[t][i], M, Y_BOUND);
+		}
+
+	__int128* polys[LANES];
+
+	for(int t=0; t<LANES; t++)
+		polys[t] = a_coeffs[t];
+
+	soa_gather(LANES, LANES, polys, soa_a);
+
+	for(int i=0; i<N; i++)
+	{
+		for(int t=0; t<LANES; t++)
+			polys[t] = lane_z[t][i];
+
+		soa_gather(LANES, LANES, polys, soa_z[i]);
+	}
+
+	pack_ring_polys(pk_polys, PK_LAYOUT, 3, pk_packed);
+	pack_ring_polys(sk_polys, SK_LAYOUT, 1, sk_packed);
+	pack_ring_polys(sig_polys, SIG_LAYOUT, 1, sig_packed);
+
+	rng_bytes_r(&source, message, MAX_MESSAGE);
+	rng_bytes_r(&source, seed, 48);
+	aes256_key_expand(&aes_key, seed);
+
+	clear_rng_r(&source);
+}
+
+// brings the stateful kernels back to the same starting point, so every implementation sees the same inputs
+static void reset_state(void)
+{
+	initialize_rng_r(&rng, seed, 48);
+	randombytes_init_r(&drbg, seed, NULL, 256);
+	memset(ctr, 0, sizeof(ctr));
+}
+
+static void run_product_in_ring(int size)
+{
+	product_in_ring(a_rows[0][0], b_rows[0][0], r_rows[0][0], true);
+}
+
+static void run_rmm_2x2(int size)
+{
+	rmm_multiply(2, 2, 2, a_matrix, b_matrix, r_matrix);
+}
+
+static void run_rmm_3x3(int size)
+{
+	rmm_multiply(3, 3, 3, a_matrix, b_matrix, r_matrix);
+}
+
+static void run_rmm_4x4(int size)
+{
+	rmm_multiply(4, 4, 4, a_matrix, b_matrix, r_matrix);
+}
+
+// a diagonal times a 2x2 matrix, as H*A in the signing of DEFIv2-1b
+static void run_rdm_2x2(int size)
+{
+	__int128* diagonal[2] = {b_rows[0][0], b_rows[1][1]};
+	
+	rdm_multiply(2, 2, diagonal, a_matrix, r_matrix);
+}
+
+static void run_rmv_3x3(int size)
+{
+	rmv_multiply(3, 3, b_matrix, v_vector, r_rows[0]);
+}
+
+static void run_rmv_4x4(int size)
+{
+	rmv_multiply(4, 4, a_matrix, v_vector, r_rows[0]);
+}
+
+// copies the soa results of the first n polynomials of each instance back to lane_out
+static void scatter_lanes(int n, __int128** soa)
+{
+	for(int i=0; i<n; i++)
+	{
+		__int128* polys[LANES];
+
+		for(int t=0; t<LANES; t++)
+			polys[t] = lane_out[t][i];
+
+		soa_scatter(LANES, LANES, soa[i], polys);
+	}
+}
+
+// the soa kernels are measured with the scatter of their results, the scalar ones on LANES instances in turn
+static void run_product_lanes_scalar(int size)
+{
+	for(int t=0; t<LANES; t++)
+		product_in_ring(a_coeffs[t], lane_z[t][0], lane_out[t][0], true);
+}
+
+static void run_product_lanes_soa(int size)
+{
+	product_in_ring_soa(LANES, soa_a, soa_z[0], soa_out[0], true);
+	scatter_lanes(1, soa_out);
+}
+
+// C*z of each instance for a shared 4x4 matrix, as in batch verification under one public key
+static void run_rmv_lanes_scalar(int size)
+{
+	for(int t=0; t<LANES; t++)
+		rmv_multiply(4, 4, a_matrix, lane_z[t], lane_out_rows[t]);
+}
+
+static void run_rmv_lanes_soa(int size)
+{
+	rmv_multiply_soa(4, 4, LANES, a_matrix, soa_z, soa_out);
+	scatter_lanes(4, soa_out);
+}
+
+// the quadratic form zCz of each instance
+static void run_zcz_lanes_scalar(int size)
+{
+	__int128 Cz_coeffs[N][M];
+	__int128* Cz[N];
+
+	for(int i=0; i<N; i++)
+		Cz[i] = Cz_coeffs[i];
+
+	for(int t=0; t<LANES; t++)
+	{
+		rmv_multiply(4, 4, a_matrix, lane_z[t], Cz);
+		zero_vector(M, lane_out[t][0]);
+
+		for(int i=0; i<N; i++)
+			product_in_ring(lane_z[t][i], Cz[i], lane_out[t][0], false);
+	}
+}
+
+static void run_zcz_lanes_soa(int size)
+{
+	rmv_multiply_soa(4, 4, LANES, a_matrix, soa_z, soa_out);
+	rvv_multiply_soa(4, LANES, soa_z, soa_out, soa_zcz);
+	scatter_lanes(1, &soa_zcz);
+}
+
+static void run_hash_of_message(int size)
+{
+	hash_of_message(message, size, r_matrix);
+}
+
+static void run_shake256(int size)
+{
+	FIPS202_SHAKE256(message, size, bytes_out, SHAKE_OUTPUT);
+}
+
+static void run_randombytes(int size)
+{
+	randombytes_r(&drbg, bytes_out, size);
+}
+
+static void run_refill_rng_buffer(int size)
+{
+	refill_rng_buffer_r(&rng);
+	memcpy(bytes_out, rng.buffer, RNG_BUFFER_SIZE);
+}
+
+static void run_aes256_ctr(int size)
+{
+	aes256_ctr_blocks(&aes_key, ctr, bytes_out, CTR_BLOCKS);
+}
+
+static void run_rngr_scalar(int size)
+{
+	for(int k=0; k<M; k++)
+		draws_out[k] = rngr_r(&rng, DRB, RB);
+}
+
+static void run_rngr_bulk(int size)
+{
+	rngr_bulk_r(&rng, DRB, RB, draws_out, M);
+}
+
+static void run_pack_pk(int size)
+{
+	pack_ring_polys(pk_polys, PK_LAYOUT, 3, bytes_out);
+}
+
+// unpacks into the first polynomials of the ring output
+static void unpack_to_output(const unsigned char* in, const pack_block* layout, int blocks)
+{
+	__int128* polys[N*N];
+
+	for(int i=0; i<N*N; i++)
+		polys[i] = r_coeffs[i];
+
+	unpack_ring_polys(in, layout, blocks, polys);
+}
+
+static void run_unpack_pk(int size)
+{
+	unpack_to_output(pk_packed, PK_LAYOUT, 3);
+}
+
+static void run_pack_sk(int size)
+{
+	pack_ring_polys(sk_polys, SK_LAYOUT, 1, bytes_out);
+}
+
+static void run_unpack_sk(int size)
+{
+	unpack_to_output(sk_packed, SK_LAYOUT, 1);
+}
+
+static void run_pack_sig(int size)
+{
+	pack_ring_polys(sig_polys, SIG_LAYOUT, 1, bytes_out);
+}
+
+static void run_unpack_sig(int size)
+{
+	unpack_to_output(sig_packed, SIG_LAYOUT, 1);
+}
+
+// all the entries of a candidate B22, as checked in key generation
+static void run_guessing_complexity(int size)
+{
+	int total = 0;
+
+	for(int i=0; i<S; i++)
+		for(int j=0; j<S; j++)
+			total += guessing_complexity(i, j, lht_coeffs[i*S + j]);
+
+	int_out = total;
+}
+
+typedef struct {
+	const char* name;
+	const char* impl;                // implementation selected before running, or NULL if there is one
+	int (*select)(const char* name); // selects impl, returns -1 if it is unavailable
+	void (*run)(int size);
+	int size;                        // message or output bytes, or 0 if it does not apply
+	const void* out;                 // output compared between implementations
+	size_t out_bytes;
+} kernel;
+
+#define RING_OUT r_coeffs, sizeof(r_coeffs)
+#define BYTES_OUT bytes_out, sizeof(bytes_out)
+#define LANE_OUT lane_out, sizeof(lane_out)
+
+static const kernel KERNELS[] = {
+	{"product_in_ring", NULL, NULL, run_product_in_ring, 0, RING_OUT},
+	{"rmm_multiply_2x2", NULL, NULL, run_rmm_2x2, 0, RING_OUT},
+	{"rmm_multiply_3x3", NULL, NULL, run_rmm_3x3, 0, RING_OUT},
+	{"rmm_multiply_4x4", NULL, NULL, run_rmm_4x4, 0, RING_OUT},
+	{"rdm_multiply_2x2", NULL, NULL, run_rdm_2x2, 0, RING_OUT},
+	{"rmv_multiply_3x3", NULL, NULL, run_rmv_3x3, 0, RING_OUT},
+	{"rmv_multiply_4x4", NULL, NULL, run_rmv_4x4, 0, RING_OUT},
+	{"product_in_ring_x8", "scalar", NULL, run_product_lanes_scalar, 0, LANE_OUT},
+	{"product_in_ring_x8", "soa", NULL, run_product_lanes_soa, 0, LANE_OUT},
+	{"rmv_multiply_4x4_x8", "scalar", NULL, run_rmv_lanes_scalar, 0, LANE_OUT},
+	{"rmv_multiply_4x4_x8", "soa", NULL, run_rmv_lanes_soa, 0, LANE_OUT},
+	{"zCz_x8", "scalar", NULL, run_zcz_lanes_scalar, 0, LANE_OUT},
+	{"zCz_x8", "soa", NULL, run_zcz_lanes_soa, 0, LANE_OUT},
+	{"hash_of_message_32", NULL, NULL, run_hash_of_message, 32, RING_OUT},
+	{"hash_of_message_1024", NULL, NULL, run_hash_of_message, 1024, RING_OUT},
+	{"hash_of_message_65536", NULL, NULL, run_hash_of_message, 65536, RING_OUT},
+	{"shake256_32", NULL, NULL, run_shake256, 32, BYTES_OUT},
+	{"shake256_136", NULL, NULL, run_shake256, 136, BYTES_OUT},
+	{"shake256_1024", NULL, NULL, run_shake256, 1024, BYTES_OUT},
+	{"shake256_65536", NULL, NULL, run_shake256, 65536, BYTES_OUT},
+	{"aes256_ctr", "portable", aes256_select, run_aes256_ctr, CTR_BLOCKS*16, BYTES_OUT},
+	{"aes256_ctr", "aesni", aes256_select, run_aes256_ctr, CTR_BLOCKS*16, BYTES_OUT},
+	{"aes256_ctr", "openssl", aes256_select, run_aes256_ctr, CTR_BLOCKS*16, BYTES_OUT},
+	{"randombytes_48", "portable", aes256_select, run_randombytes, 48, BYTES_OUT},
+	{"randombytes_48", "aesni", aes256_select, run_randombytes, 48, BYTES_OUT},
+	{"randombytes_48", "openssl", aes256_select, run_randombytes, 48, BYTES_OUT},
+	{"randombytes_1024", "portable", aes256_select, run_randombytes, RNG_BUFFER_SIZE, BYTES_OUT},
+	{"randombytes_1024", "aesni", aes256_select, run_randombytes, RNG_BUFFER_SIZE, BYTES_OUT},
+	{"randombytes_1024", "openssl", aes256_select, run_randombytes, RNG_BUFFER_SIZE, BYTES_OUT},
+	{"refill_rng_buffer", "portable", aes256_select, run_refill_rng_buffer, RNG_BUFFER_SIZE, BYTES_OUT},
+	{"refill_rng_buffer", "aesni", aes256_select, run_refill_rng_buffer, RNG_BUFFER_SIZE, BYTES_OUT},
+	{"refill_rng_buffer", "openssl", aes256_select, run_refill_rng_buffer, RNG_BUFFER_SIZE, BYTES_OUT},
+	{"rngr", "scalar", NULL, run_rngr_scalar, 0, draws_out, sizeof(draws_out)},
+	{"rngr", "bulk", NULL, run_rngr_bulk, 0, draws_out, sizeof(draws_out)},
+	{"pack_pk", "portable", pack_select, run_pack_pk, 0, BYTES_OUT},
+	{"pack_pk", "bmi2", pack_select, run_pack_pk, 0, BYTES_OUT},
+	{"unpack_pk", "portable", pack_select, run_unpack_pk, 0, RING_OUT},
+	{"unpack_pk", "bmi2", pack_select, run_unpack_pk, 0, RING_OUT},
+	{"pack_sk", "portable", pack_select, run_pack_sk, 0, BYTES_OUT},
+	{"pack_sk", "bmi2", pack_select, run_pack_sk, 0, BYTES_OUT},
+	{"unpack_sk", "portable", pack_select, run_unpack_sk, 0, RING_OUT},
+	{"unpack_sk", "bmi2", pack_select, run_unpack_sk, 0, RING_OUT},
+	{"pack_sig", "portable", pack_select, run_pack_sig, 0, BYTES_OUT},
+	{"pack_sig", "bmi2", pack_select, run_pack_sig, 0, BYTES_OUT},
+	{"unpack_sig", "portable", pack_select, run_unpack_sig, 0, RING_OUT},
+	{"unpack_sig", "bmi2", pack_select, run_unpack_sig, 0, RING_OUT},
+	{"guessing_complexity", "portable", lht_select, run_guessing_complexity, 0, &int_out, sizeof(int_out)},
+	{"guessing_complexity", "avx2", lht_select, run_guessing_complexity, 0, &int_out, sizeof(int_out)},
+};
+
+#define KERNEL_COUNT ((int)(sizeof(KERNELS)/sizeof(KERNELS[0])))
+
+// name of a kernel as given on the command line: <kernel>[/<implementation>]
+static void kernel_name(const kernel* k, char* out, size_t out_size)
+{
+	if(k->impl)
+		snprintf(out, out_size, "%s/%s", k->name, k->impl);
+	else
+		snprintf(out, out_size, "%s", k->name);
+}
+
+typedef struct {
+	int samples;
+	long target_ns;      // minimum duration of a sample, reached by repeating the kernel
+	int warmup;          // unmeasured samples
+	bool list;
+	bool perf;
+	const char* json;
+	char** patterns;
+	int pattern_count;
+} bench_options;
+
+static void usage(const char* name)
+{
+	printf("usage: %s [-l] [-n samples] [-t ns per sample] [-w warmup] [-p] [-j report.json] [pattern ...]\n", name);
+	printf("  -l       list the kernels and exit\n");
+	printf("  -p       also count cycles, instructions and cache misses with perf_event_open\n");
+	printf("  pattern  shell pattern matched against <kernel> or <kernel>/<implementation>, e.g. 'pack_*/bmi2'\n");
+	exit(1);
+}
+
+static void parse_options(int argc, char** argv, bench_options* o)
+{
+	o->samples = 1000;
+	o->target_ns = 2000;
+	o->warmup = 20;
+	o->list = false;
+	o->perf = false;
+	o->json = NULL;
+	o->patterns = NULL;
+	o->pattern_count = 0;
+
+	int i = 1;
+
+	for(; i<argc && argv[i][0] == '-'; i++)
+	{
+		bool has_value = i+1 < argc;
+
+		if(!strcmp(argv[i], "-n") && has_value)
+			o->samples = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-t") && has_value)
+			o->target_ns = atol(argv[++i]);
+		else if(!strcmp(argv[i], "-w") && has_value)
+			o->warmup = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-j") && has_value)
+			o->json = argv[++i];
+		else if(!strcmp(argv[i], "-l"))
+			o->list = true;
+		else if(!strcmp(argv[i], "-p"))
+			o->perf = true;
+		else
+			usage(argv[0]);
+	}
+
+	o->patterns = argv + i;
+	o->pattern_count = argc - i;
+
+	if(o->samples < 1 || o->target_ns < 0 || o->warmup < 0)
+		usage(argv[0]);
+}
+
+static bool selected(const bench_options* o, const kernel* k)
+{
+	char full[80];
+	kernel_name(k, full, sizeof(full));
+
+	if(o->pattern_count == 0)
+		return true;
+
+	for(int p=0; p<o->pattern_count; p++)
+		if(fnmatch(o->patterns[p], k->name, 0) == 0 || fnmatch(o->patterns[p], full, 0) == 0)
+			return true;
+
+	return false;
+}
+
+static void restore_defaults(void)
+{
+	aes256_select("auto");
+	pack_select("auto");
+	lht_select("auto");
+}
+
+// FNV-1a, to compare the outputs of the implementations of a kernel
+static uint64_t digest(const void* data, size_t bytes)
+{
+	const unsigned char* p = data;
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for(size_t i=0; i<bytes; i++)
+		h = (h ^ p[i]) * 0x100000001b3ULL;
+
+	return h;
+}
+
+// number of calls in one sample, so that it lasts at least target_ns
+static int calibrate(const kernel* k, long target_ns)
+{
+	int reps = 1;
+
+	for(;;)
+	{
+		unsigned long long start = bench_ns();
+		for(int r=0; r<reps; r++)
+			k->run(k->size);
+		unsigned long long ns = bench_ns() - start;
+
+		if(ns >= (unsigned long long)target_ns || reps >= (1 << 20))
+			return reps;
+
+		reps *= 2;
+	}
+}
+
+// measures one kernel, recording the average cost of a call in each sample
+static void measure(const kernel* k, const bench_options* o, bench_perf* perf, bench_op* op)
+{
+	int reps = calibrate(k, o->target_ns);
+
+	for(int s=0; s<o->warmup + o->samples; s++)
+	{
+		unsigned long long counts[BENCH_PERF_COUNTERS];
+
+		bench_perf_start(perf);
+		unsigned long long cycles = bench_cycles();
+		unsigned long long ns = bench_ns();
+
+		for(int r=0; r<reps; r++)
+			k->run(k->size);
+
+		ns = bench_ns() - ns;
+		cycles = bench_cycles() - cycles;
+		bench_perf_stop(perf, counts);
+
+		if(s < o->warmup)
+			continue;
+
+		bench_series_add(&op->cycles, (double)cycles / reps);
+		bench_series_add(&op->ns, (double)ns / reps);
+
+		if(perf->open)
+			for(int c=0; c<BENCH_PERF_COUNTERS; c++)
+				bench_series_add(&op->perf[c], (double)counts[c] / reps);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bench_options o;
+	parse_options(argc, argv, &o);
+
+	if(o.list)
+	{
+		for(int i=0; i<KERNEL_COUNT; i++)
+		{
+			char full[80];
+			kernel_name(&KERNELS[i], full, sizeof(full));
+
+			bool available = KERNELS[i].select == NULL || KERNELS[i].select(KERNELS[i].impl) == 0;
+			printf("%s%s\n", full, available ? "" : " (unavailable)");
+		}
+
+		restore_defaults();
+		return 0;
+	}
+
+	setup_inputs();
+
+	bench_perf perf;
+	perf.open = false;
+	if(o.perf && !bench_perf_open(&perf))
+		printf("perf_event_open is not available (check /proc/sys/kernel/perf_event_paranoid); reporting cycles and time only\n");
+
+	bench_op* op = malloc(KERNEL_COUNT*sizeof(bench_op));
+	char (*names)[80] = malloc(KERNEL_COUNT*sizeof(*names));
+	const kernel** measured = malloc(KERNEL_COUNT*sizeof(kernel*));
+	uint64_t* digests = malloc(KERNEL_COUNT*sizeof(uint64_t));
+	int ops = 0;
+	int mismatches = 0;
+
+	printf("DEFIv2-%s kernels: %d samples of at least %ld ns each, cost per call\n\n", BENCH_VARIANT, o.samples, o.target_ns);
+
+	for(int i=0; i<KERNEL_COUNT; i++)
+	{
+		const kernel* k = &KERNELS[i];
+
+		if(!selected(&o, k))
+			continue;
+
+		kernel_name(k, names[ops], sizeof(names[ops]));
+
+		if(k->select && k->select(k->impl) != 0)
+		{
+			printf("%s: unavailable in this build or on this CPU\n", names[ops]);
+			continue;
+		}
+
+		// the output of a single call from the initial state is compared with the other implementations
+		reset_state();
+		memset((void*)k->out, 0, k->out_bytes);
+		k->run(k->size);
+		digests[ops] = digest(k->out, k->out_bytes);
+
+		measured[ops] = k;
+
+		for(int j=0; j<ops; j++)
+			if(!strcmp(measured[j]->name, k->name) && digests[j] != digests[ops])
+			{
+				printf("%s: output differs from %s\n", names[ops], op[j].name);
+				mismatches++;
+				break;
+			}
+
+		bench_op_init(&op[ops], names[ops], -1);
+		measure(k, &o, &perf, &op[ops]);
+		bench_op_print(stdout, &op[ops], perf.open);
+
+		restore_defaults();
+		ops++;
+	}
+
+	if(mismatches)
+		printf("\n%d implementations disagree with another implementation of the same kernel\n", mismatches);
+
+	if(o.json)
+	{
+		FILE* out = fopen(o.json, "w");
+
+		if(out == NULL)
+		{
+			printf("Couldn't open <%s> for write\n", o.json);
+			return 1;
+		}
+
+		bench_json_begin(out, "bench_kernels", BENCH_VARIANT, o.samples);
+		for(int i=0; i<ops; i++)
+			bench_json_op(out, &op[i], perf.open, i == 0);
+		bench_json_end(out);
+
+		fclose(out);
+	}
+
+	for(int i=0; i<ops; i++)
+		bench_op_free(&op[i]);
+
+	free(op);
+	free(names);
+	free(measured);
+	free(digests);
+	bench_perf_close(&perf);
+
+	return mismatches ? 1 : 0;
+}
@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "api.h"
+#include "rng.h"
+#include "bench_functions.h"
+
+// Latency distributions of crypto_sign_keypair, crypto_sign and crypto_sign_open.
+// Usage: bench_sign_<variant> [-n runs] [-k keygen runs] [-m sizes] [-K keys] [-w warmup] [-p] [-j report.json]
+
+#ifndef BENCH_VARIANT
+#define BENCH_VARIANT "unknown"
+#endif
+
+#define MAX_SIZES 16
+
+typedef struct {
+	int runs;            // signatures (and verifications) per message size
+	int keygen_runs;
+	int sizes[MAX_SIZES];
+	int size_count;
+	int keys;            // signing keys, used in turn
+	int warmup;          // unmeasured runs of each operation
+	bool perf;
+	const char* json;
+} bench_options;
+
+static void usage(const char* name)
+{
+	printf("usage: %s [-n runs] [-k keygen runs] [-m size,size,...] [-K keys] [-w warmup] [-p] [-j report.json]\n", name);
+	printf("  -p  also count cycles, instructions and cache misses with perf_event_open\n");
+	exit(1);
+}
+
+static void parse_options(int argc, char** argv, bench_options* o)
+{
+	o->runs = 200;
+	o->keygen_runs = 100;
+	o->sizes[0] = 32;
+	o->sizes[1] = 1024;
+	o->sizes[2] = 65536;
+	o->size_count = 3;
+	o->keys = 8;
+	o->warmup = 5;
+	o->perf = false;
+	o->json = NULL;
+	
+	for(int i=1; i<argc; i++)
+	{
+		bool has_value = i+1 < argc;
+		
+		if(!strcmp(argv[i], "-n") && has_value)
+			o->runs = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-k") && has_value)
+			o->keygen_runs = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-K") && has_value)
+			o->keys = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-w") && has_value)
+			o->warmup = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-j") && has_value)
+			o->json = argv[++i];
+		else if(!strcmp(argv[i], "-p"))
+			o->perf = true;
+		else if(!strcmp(argv[i], "-m") && has_value)
+		{
+			o->size_count = 0;
+			
+			for(char* s = strtok(argv[++i], ","); s && o->size_count < MAX_SIZES; s = strtok(NULL, ","))
+				o->sizes[o->size_count++] = atoi(s);
+		}
+		else
+			usage(argv[0]);
+	}
+	
+	if(o->runs < 1 || o->keygen_runs < 1 || o->keys < 1 || o->size_count < 1)
+		usage(argv[0]);
+}
+
+// a measurement started with begin and completed with record
+typedef struct {
+	unsigned long long cycles;
+	unsigned long long ns;
+} bench_start;
+
+static bench_start begin(bench_perf* perf)
+{
+	bench_perf_start(perf);
+	
+	bench_start start = {bench_cycles(), bench_ns()};
+	
+	return start;
+}
+
+static void record(bench_op* op, bench_perf* perf, bench_start start)
+{
+	unsigned long long cycles = bench_cycles() - start.cycles;
+	unsigned long long ns = bench_ns() - start.ns;
+	unsigned long long counts[BENCH_PERF_COUNTERS];
+	
+	bench_perf_stop(perf, counts);
+	
+	bench_series_add(&op->cycles, cycles);
+	bench_series_add(&op->ns, ns);
+	
+	if(perf->open)
+		for(int c=0; c<BENCH_PERF_COUNTERS; c++)
+			bench_series_add(&op->perf[c], counts[c]);
+}
+
+int main(int argc, char** argv)
+{
+	bench_options o;
+	parse_options(argc, argv, &o);
+	
+	unsigned char entropy_input[48];
+	for(int i=0; i<48; i++)
+		entropy_input[i] = i;
+	randombytes_init(entropy_input, NULL, 256);
+	
+	bench_perf perf;
+	perf.open = false;
+	if(o.perf && !bench_perf_open(&perf))
+		printf("perf_event_open is not available (check /proc/sys/kernel/perf_event_paranoid); reporting cycles and time only\n");
+	
+	int ops = 1 + 2*o.size_count;
+	bench_op* op = malloc(ops*sizeof(bench_op));
+	unsigned char* pks = malloc((size_t)o.keys*CRYPTO_PUBLICKEYBYTES);
+	unsigned char* sks = malloc((size_t)o.keys*CRYPTO_SECRETKEYBYTES);
+	
+	printf("DEFIv2-%s: %d keygen runs, %d sign/verify runs per message size, %d keys\n\n", BENCH_VARIANT, o.keygen_runs, o.runs, o.keys);
+	
+	// keygen; the first keys generated are kept for signing
+	bench_op_init(&op[0], "keygen", -1);
+	
+	for(int r=0; r<o.warmup + o.keygen_runs || r<o.keys; r++)
+	{
+		unsigned char pk[CRYPTO_PUBLICKEYBYTES], sk[CRYPTO_SECRETKEYBYTES];
+		bool measured = r >= o.warmup && r < o.warmup + o.keygen_runs;
+		
+		bench_start start = begin(&perf);
+		crypto_sign_keypair(pk, sk);
+		if(measured)
+			record(&op[0], &perf, start);
+		
+		if(r < o.keys)
+		{
+			memcpy(pks + (size_t)r*CRYPTO_PUBLICKEYBYTES, pk, CRYPTO_PUBLICKEYBYTES);
+			memcpy(sks + (size_t)r*CRYPTO_SECRETKEYBYTES, sk, CRYPTO_SECRETKEYBYTES);
+		}
+	}
+	
+	bench_op_print(stdout, &op[0], perf.open);
+	
+	int failures = 0;
+	
+	for(int s=0; s<o.size_count; s++)
+	{
+		int size = o.sizes[s];
+		bench_op* sign = &op[1 + 2*s];
+		bench_op* open = &op[2 + 2*s];
+		bench_op_init(sign, "sign", size);
+		bench_op_init(open, "verify", size);
+		
+		unsigned char* m = malloc(size + 1);
+		unsigned char* sm = malloc(size + CRYPTO_BYTES);
+		unsigned char* m1 = malloc(size + CRYPTO_BYTES);
+		unsigned long long smlen, mlen1;
+		
+		for(int r=0; r<o.warmup + o.runs; r++)
+		{
+			int key = r % o.keys;
+			bool measured = r >= o.warmup;
+			randombytes(m, size);
+			
+			bench_start start = begin(&perf);
+			crypto_sign(sm, &smlen, m, size, sks + (size_t)key*CRYPTO_SECRETKEYBYTES);
+			if(measured)
+				record(sign, &perf, start);
+			
+			start = begin(&perf);
+			int ret = crypto_sign_open(m1, &mlen1, sm, smlen, pks + (size_t)key*CRYPTO_PUBLICKEYBYTES);
+			if(measured)
+				record(open, &perf, start);
+			
+			if(ret != 0 || mlen1 != size || memcmp(m, m1, size))
+				failures++;
+		}
+		
+		bench_op_print(stdout, sign, perf.open);
+		bench_op_print(stdout, open, perf.open);
+		
+		free(m);
+		free(sm);
+		free(m1);
+	}
+	
+	if(failures)
+		printf("\n%d signatures failed to verify\n", failures);
+	
+	if(o.json)
+	{
+		FILE* out = fopen(o.json, "w");
+		
+		if(out == NULL)
+		{
+			printf("Couldn't open <%s> for write\n", o.json);
+			return 1;
+		}
+		
+		bench_json_begin(out, "bench_sign", BENCH_VARIANT, o.runs);
+		for(int i=0; i<ops; i++)
+			bench_json_op(out, &op[i], perf.open, i == 0);
+		bench_json_end(out);
+		
+		fclose(out);
+	}
+	
+	for(int i=0; i<ops; i++)
+		bench_op_free(&op[i]);
+	
+	free(op);
+	free(pks);
+	free(sks);
+	bench_perf_close(&perf);
+	
+	return failures ? 1 : 0;
+}
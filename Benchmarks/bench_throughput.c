@@ -0,0 +1,452 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "api.h"
+#include "rng.h"
+#include "bench_functions.h"
+
+// Sustained mixed sign/verify load on 1 to all cores.
+// Each worker picks keys at random from a shared population and signs fresh messages or verifies stored signatures
+// for a fixed duration; the report gives operations per second and the scaling efficiency against one thread.
+// With -b, each request is a batch of that many operations, signed under one key with crypto_sign_batch or verified
+// with crypto_sign_open_batch.
+// Usage: bench_throughput_<variant> [-T threads,threads,...] [-d seconds] [-K keys] [-v verify percent] [-m size] [-b batch] [-a] [-j report.json]
+
+#ifndef BENCH_VARIANT
+#define BENCH_VARIANT "unknown"
+#endif
+
+#define MAX_STEPS 64
+
+typedef struct {
+	int threads[MAX_STEPS]; // thread counts to measure, in order
+	int steps;
+	double duration;        // seconds per thread count
+	int keys;
+	int verify_percent;     // share of verifications in the traffic
+	int size;               // message size
+	int batch;              // operations per request
+	bool pin;               // pins worker t to CPU t mod cores
+	const char* json;
+} bench_options;
+
+// keys, and one signed message per key for the verify traffic
+typedef struct {
+	int keys;
+	int size;
+	unsigned char* pks;
+	unsigned char* sks;
+	unsigned char* sms;
+	unsigned long long* smlens;
+} key_population;
+
+// counters of one worker, on their own cache line so the workers do not share any state of the benchmark;
+// the array of them is allocated 64 byte aligned
+typedef struct {
+	unsigned long long signs;
+	unsigned long long verifies;
+	unsigned long long failures;
+	char pad[64 - 3*sizeof(unsigned long long)];
+} worker_counts;
+
+typedef struct {
+	const bench_options* o;
+	const key_population* population;
+	int threads;
+	pthread_barrier_t start;
+	volatile int stop;
+	worker_counts* counts;
+} load_run;
+
+typedef struct {
+	load_run* run;
+	int worker;
+} load_worker;
+
+typedef struct {
+	int threads;
+	double seconds;
+	unsigned long long signs;
+	unsigned long long verifies;
+	unsigned long long failures;
+} step_result;
+
+static void usage(const char* name)
+{
+	printf("usage: %s [-T threads,threads,...] [-d seconds] [-K keys] [-v verify percent] [-m size] [-b batch] [-a] [-j report.json]\n", name);
+	printf("  -T  thread counts to measure (default 1, 2, 4, ... up to and including every online core)\n");
+	printf("  -b  operations per request, signed or verified through the batch API (default 1, one crypto_sign or crypto_sign_open)\n");
+	printf("  -a  pin each worker to a core\n");
+	exit(1);
+}
+
+static void parse_options(int argc, char** argv, bench_options* o)
+{
+	int cores = sysconf(_SC_NPROCESSORS_ONLN);
+	if(cores < 1)
+		cores = 1;
+
+	o->steps = 0;
+	for(int t=1; t<cores && o->steps < MAX_STEPS-1; t*=2)
+		o->threads[o->steps++] = t;
+	o->threads[o->steps++] = cores;
+
+	o->duration = 2.0;
+	o->keys = 64;
+	o->verify_percent = 50;
+	o->size = 32;
+	o->batch = 1;
+	o->pin = false;
+	o->json = NULL;
+
+	for(int i=1; i<argc; i++)
+	{
+		bool has_value = i+1 < argc;
+
+		if(!strcmp(argv[i], "-d") && has_value)
+			o->duration = atof(argv[++i]);
+		else if(!strcmp(argv[i], "-K") && has_value)
+			o->keys = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-v") && has_value)
+			o->verify_percent = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-m") && has_value)
+			o->size = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-b") && has_value)
+			o->batch = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "-j") && has_value)
+			o->json = argv[++i];
+		else if(!strcmp(argv[i], "-a"))
+			o->pin = true;
+		else if(!strcmp(argv[i], "-T") && has_value)
+		{
+			o->steps = 0;
+
+			for(char* s = strtok(argv[++i], ","); s && o->steps < MAX_STEPS; s = strtok(NULL, ","))
+				o->threads[o->steps++] = atoi(s);
+		}
+		else
+			usage(argv[0]);
+	}
+
+	if(o->duration <= 0 || o->keys < 1 || o->verify_percent < 0 || o->verify_percent > 100 || o->size < 0 || o->batch < 1 || o->steps < 1)
+		usage(argv[0]);
+
+	for(int s=0; s<o->steps; s++)
+		if(o->threads[s] < 1)
+			usage(argv[0]);
+}
+
+static void create_population(key_population* p, const bench_options* o)
+{
+	unsigned char master_seed[32];
+	unsigned char* m = malloc(o->size + 1);
+
+	randombytes(master_seed, 32);
+
+	p->keys = o->keys;
+	p->size = o->size;
+	p->pks = malloc((size_t)o->keys*CRYPTO_PUBLICKEYBYTES);
+	p->sks = malloc((size_t)o->keys*CRYPTO_SECRETKEYBYTES);
+	p->sms = malloc((size_t)o->keys*(o->size + CRYPTO_BYTES));
+	p->smlens = malloc(o->keys*sizeof(unsigned long long));
+
+	if(m == NULL || p->pks == NULL || p->sks == NULL || p->sms == NULL || p->smlens == NULL)
+	{
+		printf("Memory Allocation Failure!");
+		exit(2);
+	}
+
+	int cores = sysconf(_SC_NPROCESSORS_ONLN);
+	crypto_sign_keypair_batch(master_seed, o->keys, p->pks, p->sks, cores > 0 ? cores : 1);
+
+	for(int k=0; k<o->keys; k++)
+	{
+		randombytes(m, o->size);
+		crypto_sign(p->sms + (size_t)k*(o->size + CRYPTO_BYTES), &p->smlens[k], m, o->size, p->sks + (size_t)k*CRYPTO_SECRETKEYBYTES);
+	}
+
+	free(m);
+}
+
+static void free_population(key_population* p)
+{
+	memset(p->sks, 0, (size_t)p->keys*CRYPTO_SECRETKEYBYTES);
+	free(p->pks);
+	free(p->sks);
+	free(p->sms);
+	free(p->smlens);
+}
+
+// xorshift64*, the traffic pattern of a worker; it only has to be cheap and independent between workers
+static uint64_t next_random(uint64_t* state)
+{
+	*state ^= *state >> 12;
+	*state ^= *state << 25;
+	*state ^= *state >> 27;
+
+	return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static void* load_entry(void* arg)
+{
+	load_worker* w = arg;
+	load_run* run = w->run;
+	const key_population* p = run->population;
+	worker_counts* counts = &run->counts[w->worker];
+
+	if(run->o->pin)
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(w->worker % CPU_SETSIZE, &set);
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	}
+
+	// messages come from a DRBG of the worker, so the workers never contend on the global one
+	AES256_CTR_DRBG_struct drbg;
+	unsigned char entropy[48] = {0};
+	memcpy(entropy, &w->worker, sizeof(w->worker));
+	randombytes_init_r(&drbg, entropy, NULL, 256);
+
+	uint64_t state = 0x9E3779B97F4A7C15ULL * (w->worker + 1);
+	int batch = run->o->batch;
+	unsigned char* m = malloc((size_t)batch*(p->size + CRYPTO_BYTES));
+	unsigned char* sm = malloc((size_t)batch*(p->size + CRYPTO_BYTES));
+	unsigned char** ms = malloc(batch*sizeof(unsigned char*));
+	unsigned char** sms = malloc(batch*sizeof(unsigned char*));
+	const unsigned char** stored = malloc(batch*sizeof(unsigned char*));
+	const unsigned char** pks = malloc(batch*sizeof(unsigned char*));
+	unsigned long long* mlens = malloc(batch*sizeof(unsigned long long));
+	unsigned long long* smlens = malloc(batch*sizeof(unsigned long long));
+	unsigned char* results = malloc((batch + 7)/8);
+	unsigned long long smlen, mlen;
+
+	if(m == NULL || sm == NULL || ms == NULL || sms == NULL || stored == NULL || pks == NULL || mlens == NULL || smlens == NULL || results == NULL)
+	{
+		printf("Memory Allocation Failure!");
+		exit(2);
+	}
+
+	for(int b=0; b<batch; b++)
+	{
+		ms[b] = m + (size_t)b*(p->size + CRYPTO_BYTES);
+		sms[b] = sm + (size_t)b*(p->size + CRYPTO_BYTES);
+		mlens[b] = p->size;
+	}
+
+	pthread_barrier_wait(&run->start);
+
+	while(!__atomic_load_n(&run->stop, __ATOMIC_RELAXED))
+	{
+		uint64_t r = next_random(&state);
+		int key = (r >> 8) % p->keys;
+
+		if(batch > 1 && (int)(r % 100) < run->o->verify_percent)
+		{
+			for(int b=0; b<batch; b++)
+			{
+				int k = (next_random(&state) >> 8) % p->keys;
+				stored[b] = p->sms + (size_t)k*(p->size + CRYPTO_BYTES);
+				smlens[b] = p->smlens[k];
+				pks[b] = p->pks + (size_t)k*CRYPTO_PUBLICKEYBYTES;
+			}
+
+			counts->failures += crypto_sign_open_batch(NULL, NULL, stored, smlens, pks, batch, results, 1);
+			counts->verifies += batch;
+		}
+		else if(batch > 1)
+		{
+			randombytes_r(&drbg, m, (size_t)batch*(p->size + CRYPTO_BYTES));
+
+			if(crypto_sign_batch(sms, smlens, (const unsigned char* const*)ms, mlens, batch, p->sks + (size_t)key*CRYPTO_SECRETKEYBYTES, 1) != 0)
+				counts->failures++;
+
+			counts->signs += batch;
+		}
+		else if((int)(r % 100) < run->o->verify_percent)
+		{
+			const unsigned char* stored = p->sms + (size_t)key*(p->size + CRYPTO_BYTES);
+
+			if(crypto_sign_open(m, &mlen, stored, p->smlens[key], p->pks + (size_t)key*CRYPTO_PUBLICKEYBYTES) != 0)
+				counts->failures++;
+
+			counts->verifies++;
+		}
+		else
+		{
+			randombytes_r(&drbg, m, p->size);
+
+			if(crypto_sign(sm, &smlen, m, p->size, p->sks + (size_t)key*CRYPTO_SECRETKEYBYTES) != 0)
+				counts->failures++;
+
+			counts->signs++;
+		}
+	}
+
+	free(m);
+	free(sm);
+	free(ms);
+	free(sms);
+	free(stored);
+	free(pks);
+	free(mlens);
+	free(smlens);
+	free(results);
+
+	return NULL;
+}
+
+// runs the traffic on the given number of threads for the configured duration
+static step_result run_step(const bench_options* o, const key_population* p, int threads)
+{
+	load_run run;
+	run.o = o;
+	run.population = p;
+	run.threads = threads;
+	run.stop = 0;
+	run.counts = NULL;
+
+	if(posix_memalign((void**)&run.counts, 64, threads*sizeof(worker_counts)) == 0)
+		memset(run.counts, 0, threads*sizeof(worker_counts));
+
+	load_worker* w = malloc(threads*sizeof(load_worker));
+	pthread_t* tid = malloc(threads*sizeof(pthread_t));
+
+	if(run.counts == NULL || w == NULL || tid == NULL)
+	{
+		printf("Memory Allocation Failure!");
+		exit(2);
+	}
+
+	pthread_barrier_init(&run.start, NULL, threads + 1);
+
+	for(int t=0; t<threads; t++)
+	{
+		w[t].run = &run;
+		w[t].worker = t;
+
+		if(pthread_create(&tid[t], NULL, load_entry, &w[t]) != 0)
+		{
+			printf("Thread Creation Failure!");
+			exit(2);
+		}
+	}
+
+	pthread_barrier_wait(&run.start);
+	unsigned long long start = bench_ns();
+
+	struct timespec sleep_time;
+	sleep_time.tv_sec = (time_t)o->duration;
+	sleep_time.tv_nsec = (long)((o->duration - sleep_time.tv_sec) * 1e9);
+	nanosleep(&sleep_time, NULL);
+
+	__atomic_store_n(&run.stop, 1, __ATOMIC_RELAXED);
+
+	for(int t=0; t<threads; t++)
+		pthread_join(tid[t], NULL);
+
+	step_result r = {threads, (bench_ns() - start) / 1e9, 0, 0, 0};
+
+	for(int t=0; t<threads; t++)
+	{
+		r.signs += run.counts[t].signs;
+		r.verifies += run.counts[t].verifies;
+		r.failures += run.counts[t].failures;
+	}
+
+	pthread_barrier_destroy(&run.start);
+	free(run.counts);
+	free(w);
+	free(tid);
+
+	return r;
+}
+
+static double ops_per_second(const step_result* r)
+{
+	return (r->signs + r->verifies) / r->seconds;
+}
+
+// throughput per thread relative to the first measurement, scaled to one thread
+static double efficiency(const step_result* r, const step_result* base)
+{
+	return (ops_per_second(r) / r->threads) / (ops_per_second(base) / base->threads);
+}
+
+static void write_json(FILE* out, const bench_options* o, const step_result* results)
+{
+	fprintf(out, "{\n  \"tool\": \"bench_throughput\",\n  \"variant\": \"%s\",\n", BENCH_VARIANT);
+	fprintf(out, "  \"duration\": %.3f,\n  \"keys\": %d,\n  \"verify_percent\": %d,\n  \"message_bytes\": %d,\n  \"batch\": %d,\n  \"pinned\": %s,\n  \"steps\": [\n",
+		o->duration, o->keys, o->verify_percent, o->size, o->batch, o->pin ? "true" : "false");
+
+	for(int s=0; s<o->steps; s++)
+	{
+		const step_result* r = &results[s];
+
+		fprintf(out, "    {\"threads\": %d, \"seconds\": %.3f, \"signs\": %llu, \"verifies\": %llu, \"failures\": %llu, \"ops_per_second\": %.1f, \"efficiency\": %.3f}%s\n",
+			r->threads, r->seconds, r->signs, r->verifies, r->failures, ops_per_second(r), efficiency(r, &results[0]), s == o->steps-1 ? "" : ",");
+	}
+
+	fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char** argv)
+{
+	bench_options o;
+	parse_options(argc, argv, &o);
+
+	unsigned char entropy_input[48];
+	for(int i=0; i<48; i++)
+		entropy_input[i] = i;
+	randombytes_init(entropy_input, NULL, 256);
+
+	key_population population;
+	create_population(&population, &o);
+
+	printf("DEFIv2-%s: %d keys, %d byte messages, %d%% verifications, %d operations per request, %.1f s per thread count%s\n\n",
+		BENCH_VARIANT, o.keys, o.size, o.verify_percent, o.batch, o.duration, o.pin ? ", pinned" : "");
+	printf("%8s %12s %12s %12s %14s %10s\n", "threads", "signs/s", "verifies/s", "ops/s", "ops/s/thread", "scaling");
+
+	step_result results[MAX_STEPS];
+	unsigned long long failures = 0;
+
+	for(int s=0; s<o.steps; s++)
+	{
+		step_result* r = &results[s];
+		*r = run_step(&o, &population, o.threads[s]);
+		failures += r->failures;
+
+		printf("%8d %12.1f %12.1f %12.1f %14.1f %9.1f%%\n", r->threads, r->signs / r->seconds, r->verifies / r->seconds,
+			ops_per_second(r), ops_per_second(r) / r->threads, 100*efficiency(r, &results[0]));
+		fflush(stdout);
+	}
+
+	if(failures)
+		printf("\n%llu operations failed\n", failures);
+
+	if(o.json)
+	{
+		FILE* out = fopen(o.json, "w");
+
+		if(out == NULL)
+		{
+			printf("Couldn't open <%s> for write\n", o.json);
+			return 1;
+		}
+
+		write_json(out, &o, results);
+		fclose(out);
+	}
+
+	free_population(&population);
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,324 @@
+#include <stdint.h>
+#include <string.h>
+#include "aes.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#define HAVE_AESNI_DISPATCH
+#endif
+
+#ifdef USE_OPENSSL
+#include <stdio.h>
+#include <stdlib.h>
+#include <openssl/evp.h>
+#include <openssl/err.h>
+#endif
+
+// number of blocks encrypted side by side by the AES-NI backend
+#define AESNI_PIPELINE 8
+
+enum { AES_AUTO, AES_PORTABLE, AES_AESNI, AES_OPENSSL };
+
+static int aes_impl = AES_AUTO;
+
+static const unsigned char SBOX[256] =
+{
+	0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+	0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+	0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+	0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+	0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+	0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+	0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+	0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+	0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+	0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+	0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+	0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+	0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+	0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+	0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+	0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+static const unsigned char RCON[8] = {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40};
+
+static inline unsigned char xtime(unsigned char x)
+{
+	return (x << 1) ^ ((x >> 7) * 0x1b);
+}
+
+// increments a 128-bit big-endian counter, as the CTR_DRBG does for V
+static inline void ctr_increment(unsigned char* ctr)
+{
+	for(int j=15; j>=0; j--)
+	{
+		if(ctr[j] == 0xff)
+			ctr[j] = 0x00;
+		else
+		{
+			ctr[j]++;
+			break;
+		}
+	}
+}
+
+// expands a 256-bit key into the 15 round keys of AES-256
+void aes256_key_expand(aes256_key* ks, const unsigned char* key)
+{
+	unsigned char* w = &ks->round_keys[0][0];
+
+	memcpy(ks->key, key, 32);
+	memcpy(w, key, 32);
+
+	for(int i=8; i<60; i++)
+	{
+		unsigned char t[4] = {w[4*i-4], w[4*i-3], w[4*i-2], w[4*i-1]};
+
+		if(i % 8 == 0)
+		{
+			unsigned char t0 = t[0];
+			t[0] = SBOX[t[1]] ^ RCON[i/8];
+			t[1] = SBOX[t[2]];
+			t[2] = SBOX[t[3]];
+			t[3] = SBOX[t0];
+		}
+		else if(i % 8 == 4)
+		{
+			for(int j=0; j<4; j++)
+				t[j] = SBOX[t[j]];
+		}
+
+		for(int j=0; j<4; j++)
+			w[4*i+j] = w[4*(i-8)+j] ^ t[j];
+	}
+}
+
+// byte oriented AES-256 for targets without AES instructions
+static void encrypt_block_portable(const aes256_key* ks, const unsigned char* in, unsigned char* out)
+{
+	unsigned char s[16];
+	unsigned char t[16];
+
+	for(int i=0; i<16; i++)
+		s[i] = in[i] ^ ks->round_keys[0][i];
+
+	for(int r=1; r<15; r++)
+	{
+		// SubBytes and ShiftRows, the state is stored column by column
+		for(int c=0; c<4; c++)
+			for(int row=0; row<4; row++)
+				t[4*c+row] = SBOX[s[4*((c+row)&3)+row]];
+
+		// MixColumns, skipped in the last round
+		if(r < 14)
+		{
+			for(int c=0; c<4; c++)
+			{
+				unsigned char* col = t + 4*c;
+				unsigned char a = col[0] ^ col[1] ^ col[2] ^ col[3];
+				unsigned char c0 = col[0];
+
+				col[0] ^= a ^ xtime(col[0] ^ col[1]);
+				col[1] ^= a ^ xtime(col[1] ^ col[2]);
+				col[2] ^= a ^ xtime(col[2] ^ col[3]);
+				col[3] ^= a ^ xtime(col[3] ^ c0);
+			}
+		}
+
+		for(int i=0; i<16; i++)
+			s[i] = t[i] ^ ks->round_keys[r][i];
+	}
+
+	memcpy(out, s, 16);
+}
+
+static void ctr_blocks_portable(const aes256_key* ks, unsigned char* ctr, unsigned char* out, size_t blocks)
+{
+	for(size_t b=0; b<blocks; b++)
+	{
+		ctr_increment(ctr);
+		encrypt_block_portable(ks, ctr, out + 16*b);
+	}
+}
+
+#ifdef HAVE_AESNI_DISPATCH
+__attribute__((target("aes,sse2")))
+static void encrypt_block_aesni(const aes256_key* ks, const unsigned char* in, unsigned char* out)
+{
+	__m128i s = _mm_xor_si128(_mm_loadu_si128((const __m128i*)in), _mm_loadu_si128((const __m128i*)ks->round_keys[0]));
+
+	for(int r=1; r<14; r++)
+		s = _mm_aesenc_si128(s, _mm_loadu_si128((const __m128i*)ks->round_keys[r]));
+
+	s = _mm_aesenclast_si128(s, _mm_loadu_si128((const __m128i*)ks->round_keys[14]));
+	_mm_storeu_si128((__m128i*)out, s);
+}
+
+// encrypts AESNI_PIPELINE counters at once so that the aesenc latencies overlap
+__attribute__((target("aes,sse2")))
+static void ctr_blocks_aesni(const aes256_key* ks, unsigned char* ctr, unsigned char* out, size_t blocks)
+{
+	__m128i rk[15];
+
+	for(int r=0; r<15; r++)
+		rk[r] = _mm_loadu_si128((const __m128i*)ks->round_keys[r]);
+
+	for(; blocks >= AESNI_PIPELINE; blocks -= AESNI_PIPELINE, out += 16*AESNI_PIPELINE)
+	{
+		__m128i s[AESNI_PIPELINE];
+
+		for(int i=0; i<AESNI_PIPELINE; i++)
+		{
+			ctr_increment(ctr);
+			s[i] = _mm_xor_si128(_mm_loadu_si128((const __m128i*)ctr), rk[0]);
+		}
+
+		for(int r=1; r<14; r++)
+			for(int i=0; i<AESNI_PIPELINE; i++)
+				s[i] = _mm_aesenc_si128(s[i], rk[r]);
+
+		for(int i=0; i<AESNI_PIPELINE; i++)
+			_mm_storeu_si128((__m128i*)(out + 16*i), _mm_aesenclast_si128(s[i], rk[14]));
+	}
+
+	for(; blocks > 0; blocks--, out += 16)
+	{
+		__m128i s;
+
+		ctr_increment(ctr);
+		s = _mm_xor_si128(_mm_loadu_si128((const __m128i*)ctr), rk[0]);
+
+		for(int r=1; r<14; r++)
+			s = _mm_aesenc_si128(s, rk[r]);
+
+		_mm_storeu_si128((__m128i*)out, _mm_aesenclast_si128(s, rk[14]));
+	}
+}
+
+static int aesni_available(void)
+{
+	return __builtin_cpu_supports("aes");
+}
+#else
+static int aesni_available(void)
+{
+	return 0;
+}
+#endif
+
+#ifdef USE_OPENSSL
+// OpenSSL EVP backend, one cipher context per call
+static void ecb_blocks_openssl(const aes256_key* ks, const unsigned char* in, unsigned char* out, size_t blocks)
+{
+	EVP_CIPHER_CTX* ctx;
+	int len;
+
+	if(!(ctx = EVP_CIPHER_CTX_new()) || 1 != EVP_EncryptInit_ex(ctx, EVP_aes_256_ecb(), NULL, ks->key, NULL))
+	{
+		ERR_print_errors_fp(stderr);
+		abort();
+	}
+
+	EVP_CIPHER_CTX_set_padding(ctx, 0);
+
+	if(1 != EVP_EncryptUpdate(ctx, out, &len, in, 16*blocks))
+	{
+		ERR_print_errors_fp(stderr);
+		abort();
+	}
+
+	EVP_CIPHER_CTX_free(ctx);
+}
+
+static void ctr_blocks_openssl(const aes256_key* ks, unsigned char* ctr, unsigned char* out, size_t blocks)
+{
+	for(size_t b=0; b<blocks; b++)
+	{
+		ctr_increment(ctr);
+		memcpy(out + 16*b, ctr, 16);
+	}
+
+	ecb_blocks_openssl(ks, out, out, blocks);
+}
+#endif
+
+static int current_impl(void)
+{
+	if(aes_impl != AES_AUTO)
+		return aes_impl;
+
+	return aesni_available() ? AES_AESNI : AES_PORTABLE;
+}
+
+// encrypts a single block with an expanded key
+void aes256_encrypt_block(const aes256_key* ks, const unsigned char* in, unsigned char* out)
+{
+	switch(current_impl())
+	{
+#ifdef HAVE_AESNI_DISPATCH
+		case AES_AESNI:
+			encrypt_block_aesni(ks, in, out);
+			return;
+#endif
+#ifdef USE_OPENSSL
+		case AES_OPENSSL:
+			ecb_blocks_openssl(ks, in, out, 1);
+			return;
+#endif
+		default:
+			encrypt_block_portable(ks, in, out);
+	}
+}
+
+// increments the counter and encrypts it, for each of the blocks; the counter is left at the last value used
+void aes256_ctr_blocks(const aes256_key* ks, unsigned char* ctr, unsigned char* out, size_t blocks)
+{
+	switch(current_impl())
+	{
+#ifdef HAVE_AESNI_DISPATCH
+		case AES_AESNI:
+			ctr_blocks_aesni(ks, ctr, out, blocks);
+			return;
+#endif
+#ifdef USE_OPENSSL
+		case AES_OPENSSL:
+			ctr_blocks_openssl(ks, ctr, out, blocks);
+			return;
+#endif
+		default:
+			ctr_blocks_portable(ks, ctr, out, blocks);
+	}
+}
+
+int aes256_select(const char* name)
+{
+	if(strcmp(name, "auto") == 0)
+		aes_impl = AES_AUTO;
+	else if(strcmp(name, "portable") == 0)
+		aes_impl = AES_PORTABLE;
+	else if(strcmp(name, "aesni") == 0 && aesni_available())
+		aes_impl = AES_AESNI;
+#ifdef USE_OPENSSL
+	else if(strcmp(name, "openssl") == 0)
+		aes_impl = AES_OPENSSL;
+#endif
+	else
+		return -1;
+
+	return 0;
+}
+
+const char* aes256_selected(void)
+{
+	switch(current_impl())
+	{
+		case AES_AESNI:
+			return "aesni";
+		case AES_OPENSSL:
+			return "openssl";
+		default:
+			return "portable";
+	}
+}
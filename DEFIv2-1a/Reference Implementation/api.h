@@ -19,4 +19,58 @@ int crypto_sign_keypair(unsigned char *pk, unsigned char *sk);
 int crypto_sign(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk);
 int crypto_sign_open(unsigned char *m, unsigned long long *mlen, const unsigned char *sm, unsigned long long smlen, const unsigned char *pk);
 
+// Extensions to the NIST API
+
+// Generates the keypair crypto_sign_keypair returns when randombytes yields the 48 byte seed
+int crypto_sign_keypair_seeded(const unsigned char *seed, unsigned char *pk, unsigned char *sk);
+
+// Generates a keypair like crypto_sign_keypair, evaluating attempts at B22 on the given number of threads; the keypair is the same
+int crypto_sign_keypair_parallel(unsigned char *pk, unsigned char *sk, int threads);
+
+// Generates count keypairs, stored back to back in pks and sks, on the given number of threads
+// Keypair i is derived from the 32 byte master seed and i alone, through the seed expander with diversifier i
+int crypto_sign_keypair_batch(const unsigned char *master_seed, int count, unsigned char *pks, unsigned char *sks, int threads);
+
+// Signs like crypto_sign, evaluating signing candidates on the given number of threads; the signature is the same
+int crypto_sign_parallel(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk, int threads);
+
+// Signs like crypto_sign_parallel within a budget of at most max_attempts signing candidates and max_ns nanoseconds, 0 meaning
+// no limit; the time is checked between rounds of candidates, one round taking about as long as one candidate on one thread
+// Returns 0 with the signature crypto_sign would produce if a candidate within the budget is valid, and -1 otherwise, with *smlen = 0
+// Either way the candidates evaluated and the time taken are written to *attempts and *elapsed_ns, unless NULL
+// The candidates are determined by the message and the key, so a failure repeats with the same budget; parameters.h gives the
+// attempt budget that suffices for a given share of signatures
+int crypto_sign_bounded(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk,
+	int threads, unsigned long long max_attempts, unsigned long long max_ns, unsigned long long *attempts, unsigned long long *elapsed_ns);
+
+// Signs count messages under the same secret key, message i being ms[i] of mlens[i] bytes, on the given number of threads
+// The signed message of message i is written to sms[i], with room for mlens[i] + CRYPTO_BYTES bytes, and its length to smlens[i];
+// it is the same as crypto_sign would produce
+// The secret key is expanded once for the whole batch, and the messages are hashed and signed a few at a time together
+int crypto_sign_batch(unsigned char **sms, unsigned long long *smlens, const unsigned char *const *ms, const unsigned long long *mlens,
+	int count, const unsigned char *sk, int threads);
+
+// Signs the message m of mlen bytes with count secret keys sks[i], on the given number of threads
+// The signature of key i is written to sigs[i], with room for CRYPTO_BYTES bytes, and its length to siglens[i];
+// followed by m, it is the signed message crypto_sign would produce with that key
+// The message is hashed once for all the keys, and the keys are spread over the threads
+int crypto_sign_cosign(unsigned char **sigs, unsigned long long *siglens, const unsigned char *m, unsigned long long mlen,
+	const unsigned char *const *sks, int count, int threads);
+
+// Verifies count signed messages like crypto_sign_open, item i being sms[i] of smlens[i] bytes under pks[i], on the given number of threads
+// Bit i%8 of results[i/8] is set if item i is valid; returns the number of invalid items
+// ms may be NULL; otherwise the message of item i is written to ms[i] and its length to mlens[i]
+// Items with the same public key are verified together, unpacking the key once
+int crypto_sign_open_batch(unsigned char **ms, unsigned long long *mlens, const unsigned char *const *sms, const unsigned long long *smlens,
+	const unsigned char *const *pks, int count, unsigned char *results, int threads);
+
+// Verifies count signatures of the message m of mlen bytes, signature i being sigs[i] of siglens[i] bytes under pks[i],
+// as produced by crypto_sign_cosign, on the given number of threads
+// Signature i is valid if crypto_sign_open accepts it followed by m; a signature of any other length than crypto_sign_cosign
+// writes is invalid
+// Bit i%8 of results[i/8] is set if signature i is valid; returns the number of invalid signatures
+// The message is hashed once for all the signatures
+int crypto_sign_cosign_open(const unsigned char *m, unsigned long long mlen, const unsigned char *const *sigs, const unsigned long long *siglens,
+	const unsigned char *const *pks, int count, unsigned char *results, int threads);
+
 #endif /* api_h */
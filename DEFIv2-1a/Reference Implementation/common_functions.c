@@ -4,6 +4,29 @@
 #include <stdint.h>
 #include "parameters.h"
 #include "keccak.h"
+#include "pack_functions.h"
+
+void* allocate_memory(size_t size)
+{
+    void* p = malloc(size);
+    
+    if(p==NULL)
+    {
+    	printf("Memory Allocation Failure!");
+        exit(2);
+	}
+	
+	return p;
+}
+
+// zeroes size bytes at p through a volatile pointer, so that the stores are kept even when p is freed or goes out of scope next
+void secure_zero(void* p, size_t size)
+{
+	volatile unsigned char* v = p;
+	
+	for(size_t i=0; i<size; i++)
+		v[i] = 0;
+}
 
 __int128** allocate_ring_vector(int n)
 {
@@ -175,6 +198,30 @@ void product_in_ring(__int128* poly1, __int128* poly2, __int128* result_poly, bo
 	}
 }
 
+// adds the coefficients of degree [d0, d1) of poly1*poly2 modulo x^m+x+1 to result_poly
+void product_in_ring_range(__int128* poly1, __int128* poly2, __int128* result_poly, int d0, int d1)
+{
+	for(int d=d0; d<d1; d++)
+	{
+		__int128 val = 0;
+		
+		// degree i+j = d
+		for(int i=0; i<=d; i++)
+			val += poly1[i]*poly2[d-i];
+		
+		// degree i+j = M+d, reduced to x^d + x^(d+1)
+		for(int i=d+1; i<M; i++)
+			val -= poly1[i]*poly2[M+d-i];
+		
+		// degree i+j = M+d-1, reduced to x^(d-1) + x^d
+		if(d > 0)
+			for(int i=d; i<M; i++)
+				val -= poly1[i]*poly2[M+d-1-i];
+		
+		result_poly[d] += val;
+	}
+}
+
 // performs matrix-vector multiplication in the ring
 void rmv_multiply(int m, int l, __int128*** A, __int128** b, __int128** c)
 {
@@ -196,44 +243,51 @@ void rmm_multiply(int m, int l, int n, __int128*** A, __int128*** B, __int128***
 				product_in_ring(A[i][k], B[k][j], C[i][j], false);
 }
 
-// computes the hash of the message which is stored as a 2x2 matrix
-void hash_of_message(const unsigned char* m, unsigned long long mlen, __int128*** h)
+// multiplies the ring matrix A on the left by the diagonal matrix with entries D, i.e. C[i][j] = D[i]*A[i][j]
+void rdm_multiply(int m, int n, __int128** D, __int128*** A, __int128*** C)
 {
-	int hash_length = HASHSECURITY / 8;
-	int bits_per_entry = HASHSECURITY/(N*M);
-    unsigned char hash_digest[hash_length];
-	
-    FIPS202_SHAKE256(m, mlen, hash_digest, hash_length);
-    
-    bool hash_bits[HASHSECURITY];
-    int idx = 0;
-    for(int i=0; i<hash_length; i++)
-    	for(int j=0; j<8; j++)
-    		hash_bits[idx++] = (hash_digest[i] >> j) & 1;
-	
-	idx = 0;
-	
-	for(int i=0; i<2; i++)
-	{
-		for(int j=0; j<2; j++)
+	for(int i=0; i<m; i++)
+		for(int j=0; j<n; j++)
+			product_in_ring(D[i], A[i][j], C[i][j], true);
+}
+
+// computes C = A*B for ring matrices one entry at a time, stopping at the first entry with a coefficient |c| >= bound
+// returns true if every entry of C satisfies the bound
+bool rmm_multiply_bounded(int m, int l, int n, __int128*** A, __int128*** B, __int128*** C, int64_t bound)
+{
+	for(int i=0; i<m; i++)
+		for(int j=0; j<n; j++)
 		{
+			zero_vector(M, C[i][j]);
+			
+			for(int k=0; k<l; k++)
+				product_in_ring(A[i][k], B[k][j], C[i][j], false);
+			
 			for(int k=0; k<M; k++)
-			{
-				__int128 val = 0;
-				
-				for(int l=0; l<bits_per_entry; l++)
-	        		val |= (__int128)hash_bits[idx++] << l;
-	        		
-	        	h[i][j][k] = val;
-			}
+				if(C[i][j][k] >= bound || C[i][j][k] <= -bound)
+					return false;
 		}
-	}
 	
-	int sub_value = 1 << (bits_per_entry-1);
+	return true;
+}
 
-	for(int i=0; i<2; i++)
-		for(int j=0; j<2; j++)
-			for(int k=0; k<M; k++)
-        		h[i][j][k] -= sub_value;
+// unpacks the hash of the message, the first HASHSECURITY/8 bytes of its SHAKE256 digest, into a 2x2 matrix
+void hash_of_digest(const unsigned char* digest, __int128*** h)
+{
+	int bits_per_entry = HASHSECURITY/(N*M);
+	
+	// each entry is centred by subtracting 2^(bits_per_entry-1)
+	pack_block layout[1] = {{4, bits_per_entry, 1 << (bits_per_entry-1)}};
+	__int128* polys[4] = {h[0][0], h[0][1], h[1][0], h[1][1]};
+	
+	unpack_ring_polys(digest, layout, 1, polys);
 }
 
+// computes the hash of the message which is stored as a 2x2 matrix
+void hash_of_message(const unsigned char* m, unsigned long long mlen, __int128*** h)
+{
+	unsigned char hash_digest[HASHSECURITY / 8];
+	
+    FIPS202_SHAKE256(m, mlen, hash_digest, HASHSECURITY / 8);
+	hash_of_digest(hash_digest, h);
+}
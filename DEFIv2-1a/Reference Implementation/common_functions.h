@@ -2,7 +2,15 @@
 #define common_functions_h
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
+// bytes of SHAKE256 of a message used in signing: the hash is taken from the first HASHSECURITY/8 and the seed of the
+// candidates from the first 48, so one digest gives both
+#define MESSAGE_DIGEST_BYTES (HASHSECURITY/8 > 48 ? HASHSECURITY/8 : 48)
+
+void* allocate_memory(size_t size);
+void secure_zero(void* p, size_t size);
 __int128** allocate_ring_vector(int n);
 __int128*** allocate_ring_matrix(int m, int n);
 void free_ring_vector(int n, __int128** A);
@@ -13,8 +21,12 @@ void zero_ring_matrix(int m, int n, __int128*** A);
 void identity_ring_matrix(int n, __int128*** A);
 void copy_ring_matrix(int m, int n, __int128*** A, __int128*** B);
 void product_in_ring(__int128* poly1, __int128* poly2, __int128* result_poly, bool overwrite);
+void product_in_ring_range(__int128* poly1, __int128* poly2, __int128* result_poly, int d0, int d1);
 void rmv_multiply(int m, int l, __int128*** A, __int128** b, __int128** c);
 void rmm_multiply(int m, int l, int n, __int128*** A, __int128*** B, __int128*** C);
+void rdm_multiply(int m, int n, __int128** D, __int128*** A, __int128*** C);
+bool rmm_multiply_bounded(int m, int l, int n, __int128*** A, __int128*** B, __int128*** C, int64_t bound);
+void hash_of_digest(const unsigned char* digest, __int128*** h);
 void hash_of_message(const unsigned char* m, unsigned long long mlen, __int128*** h);
 
 #endif
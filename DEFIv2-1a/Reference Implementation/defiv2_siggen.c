@@ -1,10 +1,32 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include "parameters.h"
 #include "keccak.h"
 #include "rng_functions.h"
 #include "common_functions.h"
+#include "pack_functions.h"
+#include "parallel_functions.h"
+#include "soa_functions.h"
+#include "shake_functions.h"
+#include "stats_functions.h"
+#include "profile_functions.h"
+#include "defiv2_siggen.h"
+
+// number of candidates drawn per thread for each batch of the parallel signing loop
+#define SIG_CANDIDATES_PER_THREAD 2
+
+// number of coefficients of a row of y computed between two bound checks
+#define Y_BLOCK 7
+
+// number of messages of a batch signed together, their candidates evaluated as the instances of the soa kernels
+#define SIG_BATCH_LANES 4
+
+// the messages of a batch are hashed together by one call to shake256_x4
+#if SIG_BATCH_LANES != SHAKE_LANES
+#error "SIG_BATCH_LANES must match SHAKE_LANES"
+#endif
 
 // defines all possible 2x2 elementary matrices with permutations: {a1,a2,a3,a4,a5,a6}
 // {a1,a2} - position of the off diagonal non zero entry
@@ -16,40 +38,19 @@ const bool PA[4][6] = {{0,0,0,1,1,0}, {1,1,0,1,1,0}, {0,1,0,0,1,1}, {1,0,0,0,1,1
 // unpacks B22^-1 from the secret key
 void sk_to_B22inv(const unsigned char* sk, __int128*** B22inv)
 {
-	int total_bits = B22inv_BITS*S*S*M;
-	bool B22inv_bits[total_bits];
-    
-    // pk to C_bits
-    int ski = 48;
-    for(int i=0; i<total_bits; i+=8)
-    {
-    	for(int j=0; j<8; j++)
-    	   	B22inv_bits[i+j] = (sk[ski] >> j) & 1;
-    	   	
-    	ski++;
-	}
+	__int128* polys[S*S];
 	
-	int bitc = 0;
-
 	for(int i=0; i<S; i++)
-	{
 		for(int j=0; j<S; j++)
-		{
-			for(int k=0; k<M; k++)
-			{
-				__int128 val = 0;
-		
-				for(int bit=0; bit<B22inv_BITS; bit++)
-			    	val |= (__int128)B22inv_bits[bitc++] << bit;
-			    
-			    B22inv[i][j][k] = val - B22inv_BOUND;
-			}
-		}
-	}
+			polys[i*S+j] = B22inv[i][j];
+	
+	PROFILE_BEGIN(PROFILE_UNPACK);
+	unpack_ring_polys(sk+48, SK_LAYOUT, 1, polys);
+	PROFILE_END(PROFILE_UNPACK);
 }
 
-// generates a random 2x2 unimodular matrix in the ring
-void generate_random_A(__int128*** A)
+// builds a random 2x2 unimodular matrix in the ring from 3*KA draws of rng_draws_r(rng, "bbs", KA, draws)
+void build_random_A(const int* draws, __int128*** A)
 {
 	__int128*** PE = allocate_ring_matrix(2, 2);
 	__int128*** T = allocate_ring_matrix(2, 2);
@@ -59,69 +60,101 @@ void generate_random_A(__int128*** A)
 	{
 		copy_ring_matrix(2, 2, A, T);
 		
-		int i = rng_byte()&3; // mod 4
-		int k = rng_byte()%M;
+		int i = draws[3*r]&3; // mod 4
+		int k = draws[3*r+1]%M;
 		
 		zero_ring_matrix(2, 2, PE);
 		
-		PE[PA[i][0]][PA[i][1]][k] = rng2();
+		PE[PA[i][0]][PA[i][1]][k] = draws[3*r+2];
 		PE[PA[i][2]][PA[i][3]][0] = 1;
 		PE[PA[i][4]][PA[i][5]][0] = 1;
 
 		rmm_multiply(2, 2, 2, T, PE, A);
 	}
+	
+	free_ring_matrix(2, 2, PE); PE = NULL;
+	free_ring_matrix(2, 2, T); T = NULL;
 }
 
-// checks if coefficients in y satisfy its bounds
-bool valid_y(__int128** y)
+// returns the largest absolute value among the coefficients of a polynomial
+__int128 poly_max_norm(__int128* poly)
 {
-	for(int i=0; i<S; i++)
+	__int128 norm = 0;
+	
+	for(int k=0; k<M; k++)
 	{
-		for(int k=0; k<M; k++)
-		{
-			__int128 abs_val = y[i][k] < 0 ? -y[i][k] : y[i][k];
-			
-			if(abs_val>=Y_BOUND)
-			{
-				return false;
-			}
-		}
+		__int128 abs_val = poly[k] < 0 ? -poly[k] : poly[k];
+		
+		if(abs_val > norm)
+			norm = abs_val;
 	}
+	
+	return norm;
+}
 
-	return true;
+// returns the sum of the absolute values of the coefficients of a polynomial
+__int128 poly_sum_norm(__int128* poly)
+{
+	__int128 norm = 0;
+	
+	for(int k=0; k<M; k++)
+		norm += poly[k] < 0 ? -poly[k] : poly[k];
+	
+	return norm;
 }
 
-// packs the message (m) and signature (y) into the signed message (sm)
-void my_to_sm(const unsigned char* m, unsigned long long mlen, __int128** y, unsigned char* sm, unsigned long long* smlen)
+// computes y = B22^-1 * T row by row and Y_BLOCK coefficients at a time, returning false at the first coefficient outside Y_BOUND
+// a coefficient of a*b is at most 2*|a|_1*|b|_inf in absolute value, so rows whose bound is below Y_BOUND are computed without checks
+bool compute_y(__int128*** B22inv, __int128 B22inv_norm[S][S], __int128** T, __int128** y)
 {
-	int total_bits = Y_BITS*S*M;
-	bool y_bits[total_bits];
+	__int128 T_norm[S];
 	
-	int idx = 0;
+	PROFILE_BEGIN(PROFILE_BOUNDS);
+	for(int j=0; j<S; j++)
+		T_norm[j] = poly_max_norm(T[j]);
+	PROFILE_END(PROFILE_BOUNDS);
 	
-	// y
 	for(int i=0; i<S; i++)
 	{
-		for(int k=0; k<M; k++)
+		__int128 row_bound = 0;
+		
+		for(int j=0; j<S; j++)
+			row_bound += 2*B22inv_norm[i][j]*T_norm[j];
+		
+		zero_vector(M, y[i]);
+		
+		if(row_bound < Y_BOUND)
 		{
-			__int128 val = y[i][k] + Y_BOUND;
+			for(int j=0; j<S; j++)
+				product_in_ring(B22inv[i][j], T[j], y[i], false);
+			
+			continue;
+		}
 		
-			for(int bit=0; bit<Y_BITS; bit++)
-        		y_bits[idx++] = (val >> bit) & 1;
+		for(int d=0; d<M; d+=Y_BLOCK)
+		{
+			int end = d+Y_BLOCK < M ? d+Y_BLOCK : M;
+			
+			for(int j=0; j<S; j++)
+				product_in_ring_range(B22inv[i][j], T[j], y[i], d, end);
+			
+			for(int k=d; k<end; k++)
+				if(y[i][k] >= Y_BOUND || y[i][k] <= -Y_BOUND)
+					return false;
 		}
 	}
 	
-	// y_bits to sm
-	int smi = 0;
-	for(int i=0; i<total_bits; i+=8)
-	{
-		unsigned char val = 0;
-		
-		for(int j=0; j<8; j++)
-			val += y_bits[i+j] << j;
-				
-		sm[smi++] = val;
-	}
+	return true;
+}
+
+// packs the message (m) and signature (y) into the signed message (sm)
+void my_to_sm(const unsigned char* m, unsigned long long mlen, __int128** y, unsigned char* sm, unsigned long long* smlen)
+{
+	int smi = packed_bytes(SIG_LAYOUT, 1);
+	
+	PROFILE_BEGIN(PROFILE_PACK);
+	pack_ring_polys(y, SIG_LAYOUT, 1, sm);
+	PROFILE_END(PROFILE_PACK);
 	
 	*smlen = mlen + smi;
 	
@@ -130,94 +163,630 @@ void my_to_sm(const unsigned char* m, unsigned long long mlen, __int128** y, uns
 }
 
 
-// DEFIv2 signature generation for a message
-int sig_gen(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk)
+// the parts of the secret key used by every signature
+typedef struct {
+	__int128** B21;
+	__int128*** B22inv;
+	__int128 B22inv_norm[S][S]; // |B22inv[i][j]|_1
+} sig_key;
+
+void expand_sig_key(const unsigned char* sk, sig_key* key)
 {
-	initialize_rng((unsigned char*)sk, 48);
-	__int128** B21 = allocate_ring_vector(S);
+	rng_ctx rng;
+	initialize_rng_r(&rng, (unsigned char*)sk, 48);
+	key->B21 = allocate_ring_vector(S);
+	PROFILE_BEGIN(PROFILE_B21);
 	for(int i=0; i<S; i++)
-		for(int k=0; k<M; k++)
-	    	B21[i][k] = rngr(DRB, RB);
+		rngr_bulk_r(&rng, DRB, RB, key->B21[i], M);
+	PROFILE_END(PROFILE_B21);
+	clear_rng_r(&rng);
 	
-	__int128*** B22inv = allocate_ring_matrix(S, S);
-	sk_to_B22inv(sk, B22inv);
+	key->B22inv = allocate_ring_matrix(S, S);
+	sk_to_B22inv(sk, key->B22inv);
 	
-	__int128*** H = allocate_ring_matrix(2,2);
-	hash_of_message(m, mlen, H);
+	for(int i=0; i<S; i++)
+		for(int j=0; j<S; j++)
+			key->B22inv_norm[i][j] = poly_sum_norm(key->B22inv[i][j]);
+}
+
+void free_sig_key(sig_key* key)
+{
+	free_ring_vector(S, key->B21); key->B21 = NULL;
+	free_ring_matrix(S, S, key->B22inv); key->B22inv = NULL;
+}
+
+// computes H and h of a message from its SHAKE256 digest of MESSAGE_DIGEST_BYTES; neither depends on the signer
+void sig_hash(const unsigned char* digest, __int128*** H, __int128* h)
+{
+	hash_of_digest(digest, H);
 	
 	__int128 v1v4[M];
 	__int128 v2v3[M];
 	product_in_ring(H[0][0], H[1][1], v1v4, true);
 	product_in_ring(H[0][1], H[1][0], v2v3, true);
 	
-	__int128 h[M];
 	for(int k=0; k<M; k++)
 		h[k] = v1v4[k] - v2v3[k];
-	
-	__int128** B21h = allocate_ring_vector(S);
+}
+
+// computes B21*h for the signer, and seeds rng for its candidates on the message of the digest
+void sig_signer(const unsigned char* digest, __int128* h, const unsigned char* sk, const sig_key* key, __int128** B21h, rng_ctx* rng)
+{
 	for(int i=0; i<S; i++)
-		product_in_ring(B21[i], h, B21h[i], true);
-	
-	free_ring_vector(S, B21); B21 = NULL;
+		product_in_ring(key->B21[i], h, B21h[i], true);
 	
 	// Initialize rng with entropy source (currently deterministic)
 	//.....................................//
 	unsigned char new_seed[48];
-	FIPS202_SHAKE256(m, mlen, new_seed, 48);
 	for(int i=0; i<48; i++)
-		new_seed[i] += sk[i];
-	initialize_rng(new_seed, 48);
+		new_seed[i] = digest[i] + sk[i];
+	initialize_rng_r(rng, new_seed, 48);
 	//.....................................//
+}
+
+// computes H and B21*h of a message from its SHAKE256 digest of MESSAGE_DIGEST_BYTES, and seeds rng for its candidates
+void sig_message(const unsigned char* digest, const unsigned char* sk, const sig_key* key, __int128*** H, __int128** B21h, rng_ctx* rng)
+{
+	__int128 h[M];
 	
-	__int128*** A1 = allocate_ring_matrix(2, 2);  // Holds D
-	__int128*** A2 = allocate_ring_matrix(2, 2);  // Holds A
-	__int128*** HA2 = allocate_ring_matrix(2, 2); // Holds H*A
-	__int128*** V = allocate_ring_matrix(2, 2); // Holds V = D*H*A
+	sig_hash(digest, H, h);
+	sig_signer(digest, h, sk, key, B21h, rng);
+}
+
+// working memory for evaluating one candidate (A1, A2)
+typedef struct {
+	__int128*** A1;  // Holds D
+	__int128*** A2;  // Holds A
+	__int128*** HA2; // Holds H*A
+	__int128*** V;   // Holds V = D*H*A
+	__int128** T;    // Temporary vector to hold: Z"- B21*H
+} sig_scratch;
+
+// values shared by all candidates of a signature
+typedef struct {
+	__int128*** H;
+	__int128** B21h;
+	sig_key* key;
+	const int* draws;     // 6*KA draws per candidate
+	__int128*** ys;       // y of each candidate in the batch
+	sig_scratch* scratch; // one per worker
+} sig_batch;
+
+void allocate_sig_scratch(sig_scratch* w)
+{
+	w->A1 = allocate_ring_matrix(2, 2);
+	w->A2 = allocate_ring_matrix(2, 2);
+	w->HA2 = allocate_ring_matrix(2, 2);
+	w->V = allocate_ring_matrix(2, 2);
+	w->T = allocate_ring_vector(S);
+}
+
+void free_sig_scratch(sig_scratch* w)
+{
+	free_ring_matrix(2, 2, w->A1); w->A1 = NULL;
+	free_ring_matrix(2, 2, w->A2); w->A2 = NULL;
+	free_ring_matrix(2, 2, w->HA2); w->HA2 = NULL;
+	free_ring_matrix(2, 2, w->V); w->V = NULL;
+	free_ring_vector(S, w->T); w->T = NULL;
+}
+
+// computes y for the candidate (A1, A2) given by draws and checks its bounds
+bool sig_candidate(const int* draws, __int128*** H, __int128** B21h, __int128*** B22inv, __int128 B22inv_norm[S][S], sig_scratch* w, __int128** y)
+{
 	__int128 V1V2[M];
 	__int128 V1V4[M];
 	__int128 V2V3[M];
 	__int128 V3V4[M];
-	__int128** T = allocate_ring_vector(S); // Temporary vector to hold: Z"- B21*H
-	__int128** y = allocate_ring_vector(S);
+	
+	PROFILE_BEGIN(PROFILE_A);
+	build_random_A(draws, w->A1);
+	build_random_A(draws + 3*KA, w->A2);
+	PROFILE_END(PROFILE_A);
+	
+	PROFILE_BEGIN(PROFILE_VT);
+	rmm_multiply(2, 2, 2, H, w->A2, w->HA2); 
+	rmm_multiply(2, 2, 2, w->A1, w->HA2, w->V);
+	
+	product_in_ring(w->V[0][0], w->V[0][1], V1V2, true);
+	product_in_ring(w->V[0][0], w->V[1][1], V1V4, true);
+	product_in_ring(w->V[0][1], w->V[1][0], V2V3, true);
+	product_in_ring(w->V[1][0], w->V[1][1], V3V4, true);
 
-	do
+	for(int k=0; k<M; k++)
 	{
-		generate_random_A(A1);
-		generate_random_A(A2);
-		rmm_multiply(2, 2, 2, H, A2, HA2); 
-		rmm_multiply(2, 2, 2, A1, HA2, V);
-		
-		product_in_ring(V[0][0], V[0][1], V1V2, true);
-		product_in_ring(V[0][0], V[1][1], V1V4, true);
-		product_in_ring(V[0][1], V[1][0], V2V3, true);
-		product_in_ring(V[1][0], V[1][1], V3V4, true);
+		w->T[0][k] = V1V2[k] + V3V4[k] - B21h[0][k];
+		w->T[1][k] = V1V2[k] - V3V4[k] - B21h[1][k];
+		w->T[2][k] = V1V4[k] + V2V3[k] - B21h[2][k];
+	}
+	PROFILE_END(PROFILE_VT);
+	
+	PROFILE_BEGIN(PROFILE_Y);
+	bool valid = compute_y(B22inv, B22inv_norm, w->T, y);
+	PROFILE_END(PROFILE_Y);
+	
+	return valid;
+}
 
-		for(int k=0; k<M; k++)
-		{
-			T[0][k] = V1V2[k] + V3V4[k] - B21h[0][k];
-			T[1][k] = V1V2[k] - V3V4[k] - B21h[1][k];
-			T[2][k] = V1V4[k] + V2V3[k] - B21h[2][k];
-		}
+static bool sig_batch_test(void* arg, int worker, int idx)
+{
+	sig_batch* job = arg;
+	unsigned long long start = stats_now();
+	
+	if(sig_candidate(job->draws + 6*KA*idx, job->H, job->B21h, job->key->B22inv, job->key->B22inv_norm, &job->scratch[worker], job->ys[idx]))
+		return true;
+	
+	stats_reject(REJECT_Y, STATS_SIGN, start);
+	
+	return false;
+}
 
-		rmv_multiply(S, S, B22inv, T, y);
+// DEFIv2 signature generation for a message, evaluating candidates on the given number of threads, within a budget of at most
+// max_attempts candidates and max_ns nanoseconds (0 for no limit); the time is checked between batches of candidates
+// returns 0 and the signature sig_gen would produce if one of the candidates within the budget is valid, and -1 otherwise;
+// progress, unless NULL, gets the candidates evaluated and the time taken either way
+int sig_gen_bounded(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk,
+	int threads, const sig_budget* budget, sig_progress* progress)
+{
+	if(threads < 1)
+		threads = 1;
+	
+	unsigned long long begin = stats_clock();
+	unsigned long long start = stats_now();
+	sig_key key;
+	expand_sig_key(sk, &key);
+	
+	// the hash and the seed of the candidates are both taken from one digest
+	unsigned char digest[MESSAGE_DIGEST_BYTES];
+	PROFILE_BEGIN(PROFILE_HASH);
+	FIPS202_SHAKE256(m, mlen, digest, MESSAGE_DIGEST_BYTES);
+	PROFILE_END(PROFILE_HASH);
+	
+	rng_ctx rng;
+	__int128*** H = allocate_ring_matrix(2,2);
+	__int128** B21h = allocate_ring_vector(S);
+	sig_message(digest, sk, &key, H, B21h, &rng);
+	
+	// candidates are drawn in sequence order and evaluated in batches, possibly in parallel;
+	// the first valid candidate of the sequence is used, whatever the number of threads
+	int batch = threads > 1 ? SIG_CANDIDATES_PER_THREAD*threads : 1;
+	int* draws = allocate_memory(batch*6*KA*sizeof(int));
+	__int128*** ys = allocate_memory(batch*sizeof(__int128**));
+	sig_scratch* scratch = allocate_memory(threads*sizeof(sig_scratch));
+	
+	for(int c=0; c<batch; c++)
+		ys[c] = allocate_ring_vector(S);
+	
+	for(int t=0; t<threads; t++)
+		allocate_sig_scratch(&scratch[t]);
+	
+	sig_batch job = {H, B21h, &key, draws, ys, scratch};
+	unsigned long long max_attempts = budget ? budget->max_attempts : 0;
+	unsigned long long max_ns = budget ? budget->max_ns : 0;
+	unsigned long long attempts = 0;
+	int winner = -1;
+	
+	while(winner < 0)
+	{
+		if(max_ns != 0 && stats_clock() - begin >= max_ns)
+			break;
+		
+		if(max_attempts != 0 && attempts >= max_attempts)
+			break;
+		
+		// the last batch is cut to the attempts left, so the candidates tested do not depend on the number of threads
+		int round = max_attempts != 0 && max_attempts - attempts < batch ? max_attempts - attempts : batch;
+		
+		PROFILE_BEGIN(PROFILE_A);
+		rng_draws_r(&rng, "bbs", 2*KA*round, draws);
+		PROFILE_END(PROFILE_A);
+		winner = parallel_first(threads, round, sig_batch_test, &job);
+		attempts += winner >= 0 ? winner + 1 : round;
 	}
-	while(valid_y(y)==false);
 	
-	clear_rng();
+	clear_rng_r(&rng);
 	
-	free_ring_matrix(S, S, B22inv); B22inv = NULL;
+	if(winner >= 0)
+	{
+		stats_operation(STATS_SIGN, attempts, start);
+		my_to_sm(m, mlen, ys[winner], sm, smlen);
+	}
+	else
+		*smlen = 0;
+	
+	if(progress != NULL)
+	{
+		progress->attempts = attempts;
+		progress->elapsed_ns = stats_clock() - begin;
+	}
+	
+	free_sig_key(&key);
 	free_ring_matrix(2, 2, H); H = NULL;
 	free_ring_vector(S, B21h); B21h = NULL;
-	free_ring_matrix(2, 2, A1); A1 = NULL;
-	free_ring_matrix(2, 2, A2); A2 = NULL;
-	free_ring_matrix(2, 2, HA2); HA2 = NULL;
-	free_ring_matrix(2, 2, V); V = NULL;
-	free_ring_vector(S, T); T = NULL;
 	
-	my_to_sm(m, mlen, y, sm, smlen);
+	for(int t=0; t<threads; t++)
+		free_sig_scratch(&scratch[t]);
+	
+	for(int c=0; c<batch; c++)
+		free_ring_vector(S, ys[c]);
+	
+	free(scratch); scratch = NULL;
+	free(ys); ys = NULL;
+	free(draws); draws = NULL;
+	
+	return winner >= 0 ? 0 : -1;
+}
+
+// DEFIv2 signature generation for a message, evaluating candidates on the given number of threads
+int sig_gen_mt(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk, int threads)
+{
+	return sig_gen_bounded(sm, smlen, m, mlen, sk, threads, NULL, NULL);
+}
+
+// DEFIv2 signature generation for a message
+int sig_gen(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk)
+{
+	return sig_gen_mt(sm, smlen, m, mlen, sk, 1);
+}
+
+// working memory for signing up to SIG_BATCH_LANES messages together
+typedef struct {
+	rng_ctx rng[SIG_BATCH_LANES];
+	__int128*** H[SIG_BATCH_LANES];
+	__int128** B21h[SIG_BATCH_LANES];
+	__int128*** A1[SIG_BATCH_LANES];
+	__int128*** A2[SIG_BATCH_LANES];
+	__int128** y[SIG_BATCH_LANES];
+	// one instance for each message still looking for a valid candidate (see soa_functions.h)
+	__int128*** Hs;
+	__int128*** A1s;
+	__int128*** A2s;
+	__int128*** HA2s;
+	__int128*** Vs;
+	__int128** B21hs;
+	__int128** VVs;  // V1V2, V1V4, V2V3 and V3V4
+	__int128** Ts;
+	__int128** ys;
+} sig_lanes_scratch;
+
+// the messages of a batch, signed SIG_BATCH_LANES at a time
+typedef struct {
+	unsigned char** sms;
+	unsigned long long* smlens;
+	const unsigned char* const* ms;
+	const unsigned long long* mlens;
+	int count;
+	const unsigned char* sk;
+	const sig_key* key;
+	sig_lanes_scratch* scratch; // one per worker
+} sig_gen_batch_job;
+
+void allocate_sig_lanes_scratch(sig_lanes_scratch* w)
+{
+	for(int t=0; t<SIG_BATCH_LANES; t++)
+	{
+		w->H[t] = allocate_ring_matrix(2, 2);
+		w->B21h[t] = allocate_ring_vector(S);
+		w->A1[t] = allocate_ring_matrix(2, 2);
+		w->A2[t] = allocate_ring_matrix(2, 2);
+		w->y[t] = allocate_ring_vector(S);
+	}
+	
+	w->Hs = allocate_soa_matrix(2, 2, SIG_BATCH_LANES);
+	w->A1s = allocate_soa_matrix(2, 2, SIG_BATCH_LANES);
+	w->A2s = allocate_soa_matrix(2, 2, SIG_BATCH_LANES);
+	w->HA2s = allocate_soa_matrix(2, 2, SIG_BATCH_LANES);
+	w->Vs = allocate_soa_matrix(2, 2, SIG_BATCH_LANES);
+	w->B21hs = allocate_soa_vector(S, SIG_BATCH_LANES);
+	w->VVs = allocate_soa_vector(4, SIG_BATCH_LANES);
+	w->Ts = allocate_soa_vector(S, SIG_BATCH_LANES);
+	w->ys = allocate_soa_vector(S, SIG_BATCH_LANES);
+}
+
+void free_sig_lanes_scratch(sig_lanes_scratch* w)
+{
+	for(int t=0; t<SIG_BATCH_LANES; t++)
+	{
+		free_ring_matrix(2, 2, w->H[t]); w->H[t] = NULL;
+		free_ring_vector(S, w->B21h[t]); w->B21h[t] = NULL;
+		free_ring_matrix(2, 2, w->A1[t]); w->A1[t] = NULL;
+		free_ring_matrix(2, 2, w->A2[t]); w->A2[t] = NULL;
+		free_ring_vector(S, w->y[t]); w->y[t] = NULL;
+	}
+	
+	free_soa_matrix(2, 2, w->Hs); w->Hs = NULL;
+	free_soa_matrix(2, 2, w->A1s); w->A1s = NULL;
+	free_soa_matrix(2, 2, w->A2s); w->A2s = NULL;
+	free_soa_matrix(2, 2, w->HA2s); w->HA2s = NULL;
+	free_soa_matrix(2, 2, w->Vs); w->Vs = NULL;
+	free_soa_vector(S, w->B21hs); w->B21hs = NULL;
+	free_soa_vector(4, w->VVs); w->VVs = NULL;
+	free_soa_vector(S, w->Ts); w->Ts = NULL;
+	free_soa_vector(S, w->ys); w->ys = NULL;
+}
+
+// gathers entry (i, j) of the 2x2 matrices of the given messages into a soa polynomial
+static void gather_entry(int lanes, const int* msg, __int128**** A, int i, int j, __int128* soa)
+{
+	__int128* polys[SIG_BATCH_LANES];
+	
+	for(int p=0; p<lanes; p++)
+		polys[p] = A[msg[p]][i][j];
+	
+	soa_gather(lanes, lanes, polys, soa);
+}
+
+// computes y of the next candidate of each of the given messages, as sig_candidate does, as instances of the soa kernels;
+// valid[p] is set if y of message msg[p] satisfies its bounds, and then y is left in w->y[msg[p]]
+static void sig_lanes_candidates(int lanes, const int* msg, const sig_key* key, sig_lanes_scratch* w, bool* valid)
+{
+	PROFILE_BEGIN(PROFILE_VT);
+	for(int i=0; i<2; i++)
+		for(int j=0; j<2; j++)
+		{
+			gather_entry(lanes, msg, w->H, i, j, w->Hs[i][j]);
+			gather_entry(lanes, msg, w->A1, i, j, w->A1s[i][j]);
+			gather_entry(lanes, msg, w->A2, i, j, w->A2s[i][j]);
+		}
+	
+	for(int i=0; i<S; i++)
+	{
+		__int128* polys[SIG_BATCH_LANES];
+		
+		for(int p=0; p<lanes; p++)
+			polys[p] = w->B21h[msg[p]][i];
+		
+		soa_gather(lanes, lanes, polys, w->B21hs[i]);
+	}
+	
+	rmm_multiply_soa(2, 2, 2, lanes, w->Hs, w->A2s, w->HA2s);
+	rmm_multiply_soa(2, 2, 2, lanes, w->A1s, w->HA2s, w->Vs);
+	
+	product_in_ring_soa(lanes, w->Vs[0][0], w->Vs[0][1], w->VVs[0], true);
+	product_in_ring_soa(lanes, w->Vs[0][0], w->Vs[1][1], w->VVs[1], true);
+	product_in_ring_soa(lanes, w->Vs[0][1], w->Vs[1][0], w->VVs[2], true);
+	product_in_ring_soa(lanes, w->Vs[1][0], w->Vs[1][1], w->VVs[3], true);
+	
+	for(int k=0; k<M*lanes; k++)
+	{
+		w->Ts[0][k] = w->VVs[0][k] + w->VVs[3][k] - w->B21hs[0][k];
+		w->Ts[1][k] = w->VVs[0][k] - w->VVs[3][k] - w->B21hs[1][k];
+		w->Ts[2][k] = w->VVs[1][k] + w->VVs[2][k] - w->B21hs[2][k];
+	}
+	PROFILE_END(PROFILE_VT);
+	
+	// y is computed in full, which accepts exactly the candidates compute_y accepts
+	PROFILE_BEGIN(PROFILE_Y);
+	rmv_multiply_soa(S, S, lanes, key->B22inv, w->Ts, w->ys);
+	
+	for(int p=0; p<lanes; p++)
+		valid[p] = true;
+	
+	for(int i=0; i<S; i++)
+		for(int k=0; k<M*lanes; k++)
+			if(w->ys[i][k] >= Y_BOUND || w->ys[i][k] <= -Y_BOUND)
+				valid[k%lanes] = false;
+	
+	for(int p=0; p<lanes; p++)
+		if(valid[p])
+			for(int i=0; i<S; i++)
+				for(int k=0; k<M; k++)
+					w->y[msg[p]][i][k] = w->ys[i][k*lanes+p];
+	PROFILE_END(PROFILE_Y);
+}
 
-	free_ring_vector(S, y); y = NULL;
+// signs messages [task*SIG_BATCH_LANES, task*SIG_BATCH_LANES + SIG_BATCH_LANES) of the batch
+// the messages draw and test their candidates in rounds, each round evaluating one candidate of every message without
+// a signature yet; each message still sees the sequence of candidates sig_gen would, so its signature is the same
+static void sig_gen_batch_task(void* arg, int worker, int task)
+{
+	sig_gen_batch_job* job = arg;
+	sig_lanes_scratch* w = &job->scratch[worker];
+	int first = task*SIG_BATCH_LANES;
+	int count = job->count - first < SIG_BATCH_LANES ? job->count - first : SIG_BATCH_LANES;
+	unsigned long long start = stats_now();
+	
+	const unsigned char* inputs[SIG_BATCH_LANES] = {NULL};
+	unsigned long long input_lens[SIG_BATCH_LANES] = {0};
+	unsigned char digests[SIG_BATCH_LANES][MESSAGE_DIGEST_BYTES];
+	unsigned char* outputs[SIG_BATCH_LANES];
+	
+	for(int t=0; t<SIG_BATCH_LANES; t++)
+	{
+		inputs[t] = t < count ? job->ms[first+t] : NULL;
+		input_lens[t] = t < count ? job->mlens[first+t] : 0;
+		outputs[t] = digests[t];
+	}
+	
+	PROFILE_BEGIN(PROFILE_HASH);
+	shake256_x4(inputs, input_lens, outputs, MESSAGE_DIGEST_BYTES);
+	PROFILE_END(PROFILE_HASH);
+	
+	int pending[SIG_BATCH_LANES];
+	unsigned long long attempts[SIG_BATCH_LANES];
+	int lanes = count;
+	
+	for(int t=0; t<count; t++)
+	{
+		sig_message(digests[t], job->sk, job->key, w->H[t], w->B21h[t], &w->rng[t]);
+		pending[t] = t;
+		attempts[t] = 0;
+	}
+	
+	while(lanes > 0)
+	{
+		unsigned long long round_start = stats_now();
+		bool valid[SIG_BATCH_LANES];
+		
+		PROFILE_BEGIN(PROFILE_A);
+		for(int p=0; p<lanes; p++)
+		{
+			int t = pending[p];
+			int draws[6*KA];
+			
+			rng_draws_r(&w->rng[t], "bbs", 2*KA, draws);
+			build_random_A(draws, w->A1[t]);
+			build_random_A(draws + 3*KA, w->A2[t]);
+			attempts[t]++;
+		}
+		PROFILE_END(PROFILE_A);
+		
+		sig_lanes_candidates(lanes, pending, job->key, w, valid);
+		
+		int left = 0;
+		
+		for(int p=0; p<lanes; p++)
+		{
+			int t = pending[p];
+			
+			if(valid[p])
+			{
+				clear_rng_r(&w->rng[t]);
+				my_to_sm(job->ms[first+t], job->mlens[first+t], w->y[t], job->sms[first+t], &job->smlens[first+t]);
+				stats_operation(STATS_SIGN, attempts[t], start);
+			}
+			else
+			{
+				stats_reject(REJECT_Y, STATS_SIGN, round_start);
+				pending[left++] = t;
+			}
+		}
+		
+		lanes = left;
+	}
+}
 
+// DEFIv2 signature generation for count messages under the same secret key, on the given number of threads
+// the secret key is expanded once, and the messages are hashed and their candidates evaluated SIG_BATCH_LANES at a time
+int sig_gen_batch(unsigned char** sms, unsigned long long* smlens, const unsigned char* const* ms, const unsigned long long* mlens,
+	int count, const unsigned char* sk, int threads)
+{
+	if(threads < 1)
+		threads = 1;
+	
+	if(count <= 0)
+		return 0;
+	
+	int tasks = (count + SIG_BATCH_LANES - 1) / SIG_BATCH_LANES;
+	
+	if(threads > tasks)
+		threads = tasks;
+	
+	sig_key key;
+	expand_sig_key(sk, &key);
+	
+	sig_lanes_scratch* scratch = allocate_memory(threads*sizeof(sig_lanes_scratch));
+	for(int t=0; t<threads; t++)
+		allocate_sig_lanes_scratch(&scratch[t]);
+	
+	sig_gen_batch_job job = {sms, smlens, ms, mlens, count, sk, &key, scratch};
+	parallel_steal(threads, tasks, sig_gen_batch_task, &job);
+	
+	for(int t=0; t<threads; t++)
+		free_sig_lanes_scratch(&scratch[t]);
+	
+	free(scratch); scratch = NULL;
+	free_sig_key(&key);
+	
 	return 0;
 }
 
+// a message signed by several secret keys, one task each
+typedef struct {
+	unsigned char** sigs;
+	unsigned long long* siglens;
+	const unsigned char* const* sks;
+	const unsigned char* digest;
+	__int128*** H;
+	__int128* h;
+	sig_scratch* scratch; // one per worker
+	__int128*** ys;       // one per worker
+} sig_gen_cosign_job;
+
+// signs the message of the job with secret key i, drawing and testing candidates one at a time as sig_gen does
+static void sig_gen_cosign_task(void* arg, int worker, int i)
+{
+	sig_gen_cosign_job* job = arg;
+	unsigned long long start = stats_now();
+	sig_key key;
+	expand_sig_key(job->sks[i], &key);
+	
+	rng_ctx rng;
+	__int128** B21h = allocate_ring_vector(S);
+	sig_signer(job->digest, job->h, job->sks[i], &key, B21h, &rng);
+	
+	__int128** y = job->ys[worker];
+	int draws[6*KA];
+	unsigned long long attempts = 0;
+	bool valid = false;
+	
+	while(!valid)
+	{
+		unsigned long long attempt_start = stats_now();
+		attempts++;
+		
+		PROFILE_BEGIN(PROFILE_A);
+		rng_draws_r(&rng, "bbs", 2*KA, draws);
+		PROFILE_END(PROFILE_A);
+		valid = sig_candidate(draws, job->H, B21h, key.B22inv, key.B22inv_norm, &job->scratch[worker], y);
+		
+		if(!valid)
+			stats_reject(REJECT_Y, STATS_SIGN, attempt_start);
+	}
+	
+	clear_rng_r(&rng);
+	stats_operation(STATS_SIGN, attempts, start);
+	
+	// the signature alone, without the message
+	my_to_sm(NULL, 0, y, job->sigs[i], &job->siglens[i]);
+	
+	free_ring_vector(S, B21h); B21h = NULL;
+	free_sig_key(&key);
+}
+
+// DEFIv2 signatures of one message by count secret keys, on the given number of threads
+// the message is hashed and h computed once for all the signers; sigs[i] gets y of signer i, packed as in a signed message
+int sig_gen_cosign(unsigned char** sigs, unsigned long long* siglens, const unsigned char* m, unsigned long long mlen,
+	const unsigned char* const* sks, int count, int threads)
+{
+	if(threads < 1)
+		threads = 1;
+	
+	if(count <= 0)
+		return 0;
+	
+	if(threads > count)
+		threads = count;
+	
+	unsigned char digest[MESSAGE_DIGEST_BYTES];
+	PROFILE_BEGIN(PROFILE_HASH);
+	FIPS202_SHAKE256(m, mlen, digest, MESSAGE_DIGEST_BYTES);
+	PROFILE_END(PROFILE_HASH);
+	
+	__int128*** H = allocate_ring_matrix(2, 2);
+	__int128 h[M];
+	sig_hash(digest, H, h);
+	
+	sig_scratch* scratch = allocate_memory(threads*sizeof(sig_scratch));
+	__int128*** ys = allocate_memory(threads*sizeof(__int128**));
+	
+	for(int t=0; t<threads; t++)
+	{
+		allocate_sig_scratch(&scratch[t]);
+		ys[t] = allocate_ring_vector(S);
+	}
+	
+	sig_gen_cosign_job job = {sigs, siglens, sks, digest, H, h, scratch, ys};
+	parallel_steal(threads, count, sig_gen_cosign_task, &job);
+	
+	for(int t=0; t<threads; t++)
+	{
+		free_sig_scratch(&scratch[t]);
+		free_ring_vector(S, ys[t]);
+	}
+	
+	free(scratch); scratch = NULL;
+	free(ys); ys = NULL;
+	free_ring_matrix(2, 2, H); H = NULL;
+	
+	return 0;
+}
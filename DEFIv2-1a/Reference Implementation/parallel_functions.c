@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "common_functions.h"
+#include "parallel_functions.h"
+
+typedef struct {
+	void (*work)(void* arg, int worker);
+	void* arg;
+	int worker;
+} parallel_worker;
+
+static void* parallel_entry(void* p)
+{
+	parallel_worker* w = p;
+	w->work(w->arg, w->worker);
+	return NULL;
+}
+
+// runs work(arg, worker) for worker = 0..threads-1, worker 0 on the calling thread, and waits for all of them
+void parallel_run(int threads, void (*work)(void* arg, int worker), void* arg)
+{
+	if(threads <= 1)
+	{
+		work(arg, 0);
+		return;
+	}
+	
+	pthread_t tid[threads];
+	parallel_worker w[threads];
+	
+	for(int t=0; t<threads; t++)
+	{
+		w[t].work = work;
+		w[t].arg = arg;
+		w[t].worker = t;
+	}
+	
+	for(int t=1; t<threads; t++)
+	{
+		if(pthread_create(&tid[t], NULL, parallel_entry, &w[t]) != 0)
+		{
+			printf("Thread Creation Failure!");
+			exit(2);
+		}
+	}
+	
+	work(arg, 0);
+	
+	for(int t=1; t<threads; t++)
+		pthread_join(tid[t], NULL);
+}
+
+typedef struct {
+	bool (*test)(void* arg, int worker, int idx);
+	void* arg;
+	int count;
+	int next; // next index to hand out
+	int best; // smallest index that passed so far, count if none
+} parallel_search;
+
+static void parallel_first_worker(void* p, int worker)
+{
+	parallel_search* s = p;
+	
+	while(1)
+	{
+		int idx = __atomic_fetch_add(&s->next, 1, __ATOMIC_RELAXED);
+		
+		if(idx >= __atomic_load_n(&s->best, __ATOMIC_ACQUIRE))
+			return;
+		
+		if(s->test(s->arg, worker, idx))
+		{
+			int best = __atomic_load_n(&s->best, __ATOMIC_RELAXED);
+			
+			while(idx < best && !__atomic_compare_exchange_n(&s->best, &best, idx, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+				;
+			
+			return;
+		}
+	}
+}
+
+// returns the smallest idx in [0, count) for which test(arg, worker, idx) is true, or -1 if there is none
+// indices are handed out in increasing order, so every index below the result has been tested
+// and the result does not depend on the number of threads; indices above a passing one are skipped
+int parallel_first(int threads, int count, bool (*test)(void* arg, int worker, int idx), void* arg)
+{
+	parallel_search s = {test, arg, count, 0, count};
+	
+	if(threads > count)
+		threads = count;
+	
+	parallel_run(threads, parallel_first_worker, &s);
+	
+	return s.best < count ? s.best : -1;
+}
+
+typedef struct {
+	void (*work)(void* arg, int worker, int idx);
+	void* arg;
+	int count;
+	int next; // next index to hand out
+} parallel_loop;
+
+static void parallel_for_worker(void* p, int worker)
+{
+	parallel_loop* l = p;
+	int idx;
+	
+	while((idx = __atomic_fetch_add(&l->next, 1, __ATOMIC_RELAXED)) < l->count)
+		l->work(l->arg, worker, idx);
+}
+
+// runs work(arg, worker, idx) for every idx in [0, count), handing out indices one at a time to whichever thread is free
+void parallel_for(int threads, int count, void (*work)(void* arg, int worker, int idx), void* arg)
+{
+	parallel_loop l = {work, arg, count, 0};
+	
+	if(threads > count)
+		threads = count;
+	
+	parallel_run(threads, parallel_for_worker, &l);
+}
+
+// the indices still to run by one worker, [begin, end); padded so the shares of different workers do not share a cache line
+typedef struct {
+	pthread_mutex_t lock;
+	int begin;
+	int end;
+	char pad[64];
+} parallel_share;
+
+typedef struct {
+	void (*work)(void* arg, int worker, int idx);
+	void* arg;
+	int threads;
+	parallel_share* shares;
+} parallel_pool;
+
+// takes the next index of the worker's own share, or -1 if it is empty
+static int parallel_take(parallel_share* share)
+{
+	int idx = -1;
+	
+	pthread_mutex_lock(&share->lock);
+	if(share->begin < share->end)
+		__atomic_store_n(&share->begin, (idx = share->begin) + 1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&share->lock);
+	
+	return idx;
+}
+
+// the sizes of the shares are read without their locks, as a hint, so they are stored atomically
+// moves the upper half of the largest other share to the worker's own share; returns false if there is nothing left
+static bool parallel_steal_half(parallel_pool* p, int worker)
+{
+	for(;;)
+	{
+		int victim = -1;
+		int most = 0;
+		
+		for(int t=0; t<p->threads; t++)
+		{
+			int left = __atomic_load_n(&p->shares[t].end, __ATOMIC_RELAXED) - __atomic_load_n(&p->shares[t].begin, __ATOMIC_RELAXED);
+			
+			if(t != worker && left > most)
+			{
+				victim = t;
+				most = left;
+			}
+		}
+		
+		if(victim < 0)
+			return false;
+		
+		parallel_share* v = &p->shares[victim];
+		int begin, end;
+		
+		pthread_mutex_lock(&v->lock);
+		end = v->end;
+		begin = v->begin + (v->end - v->begin) / 2;
+		__atomic_store_n(&v->end, begin, __ATOMIC_RELAXED);
+		pthread_mutex_unlock(&v->lock);
+		
+		// the victim may have emptied its share in the meantime; look again
+		if(begin < end)
+		{
+			parallel_share* own = &p->shares[worker];
+			
+			pthread_mutex_lock(&own->lock);
+			__atomic_store_n(&own->begin, begin, __ATOMIC_RELAXED);
+			__atomic_store_n(&own->end, end, __ATOMIC_RELAXED);
+			pthread_mutex_unlock(&own->lock);
+			
+			return true;
+		}
+	}
+}
+
+static void parallel_steal_worker(void* arg, int worker)
+{
+	parallel_pool* p = arg;
+	
+	do
+	{
+		int idx;
+		
+		while((idx = parallel_take(&p->shares[worker])) >= 0)
+			p->work(p->arg, worker, idx);
+	}
+	while(parallel_steal_half(p, worker));
+}
+
+// runs work(arg, worker, idx) for every idx in [0, count)
+// each thread starts on its own contiguous share of the indices, in increasing order, so neighbouring indices
+// tend to run on the same thread; a thread that runs out steals the upper half of the largest remaining share
+void parallel_steal(int threads, int count, void (*work)(void* arg, int worker, int idx), void* arg)
+{
+	if(threads > count)
+		threads = count;
+	if(threads < 1)
+		threads = 1;
+	
+	parallel_share* shares = allocate_memory(threads*sizeof(parallel_share));
+	parallel_pool p = {work, arg, threads, shares};
+	
+	for(int t=0; t<threads; t++)
+	{
+		pthread_mutex_init(&shares[t].lock, NULL);
+		shares[t].begin = (long long)count*t/threads;
+		shares[t].end = (long long)count*(t+1)/threads;
+	}
+	
+	parallel_run(threads, parallel_steal_worker, &p);
+	
+	for(int t=0; t<threads; t++)
+		pthread_mutex_destroy(&shares[t].lock);
+	
+	free(shares);
+}
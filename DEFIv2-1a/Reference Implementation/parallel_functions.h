@@ -0,0 +1,11 @@
+#ifndef parallel_functions_h
+#define parallel_functions_h
+
+#include <stdbool.h>
+
+void parallel_run(int threads, void (*work)(void* arg, int worker), void* arg);
+void parallel_for(int threads, int count, void (*work)(void* arg, int worker, int idx), void* arg);
+void parallel_steal(int threads, int count, void (*work)(void* arg, int worker, int idx), void* arg);
+int parallel_first(int threads, int count, bool (*test)(void* arg, int worker, int idx), void* arg);
+
+#endif
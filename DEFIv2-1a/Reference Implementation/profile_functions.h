@@ -0,0 +1,57 @@
+#ifndef profile_functions_h
+#define profile_functions_h
+
+// Per-phase cycle counts of key generation, signing and verification.
+// The hooks are compiled in only with -DDEFIV2_PROFILE (make PROFILE=1); otherwise they are empty and the counts stay zero.
+// Phases nest: the DRBG time is also counted in the phase that consumed the random bytes, and bound checks
+// in the phase that contains them.
+
+typedef enum {
+	PROFILE_DRBG,    // randombytes_r
+	PROFILE_B21,     // sampling B21
+	PROFILE_B22,     // generating B22 and B22^-1 (key generation)
+	PROFILE_C,       // computing C (key generation)
+	PROFILE_UNPACK,  // sk_to_B22inv, pk_to_C, unpacking y
+	PROFILE_HASH,    // hash_of_message
+	PROFILE_A,       // drawing and building the A matrices (signing)
+	PROFILE_VT,      // the V and T products (signing)
+	PROFILE_Y,       // y = B22^-1 T (signing)
+	PROFILE_ZCZ,     // the products z^T C z (verification)
+	PROFILE_BOUNDS,  // guessing complexity and the norm bound of y
+	PROFILE_PACK,    // packing pk, sk and the signature
+	PROFILE_PHASES
+} profile_phase;
+
+typedef struct {
+	unsigned long long cycles[PROFILE_PHASES];
+	unsigned long long calls[PROFILE_PHASES];
+} profile_data;
+
+typedef void (*profile_callback)(profile_phase phase, unsigned long long cycles, void* arg);
+
+const char* profile_phase_name(profile_phase phase);
+void profile_snapshot(profile_data* data);
+void profile_reset(void);
+void profile_set_callback(profile_callback callback, void* arg);
+void profile_add(profile_phase phase, unsigned long long cycles);
+
+#ifdef DEFIV2_PROFILE
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define profile_cycles() __rdtsc()
+#else
+unsigned long long profile_cycles(void);
+#endif
+
+#define PROFILE_BEGIN(phase) unsigned long long profile_start_##phase = profile_cycles()
+#define PROFILE_END(phase) profile_add(phase, profile_cycles() - profile_start_##phase)
+
+#else
+
+#define PROFILE_BEGIN(phase)
+#define PROFILE_END(phase)
+
+#endif
+
+#endif
@@ -2,79 +2,76 @@
 #include <stdbool.h>
 #include <string.h>
 #include "rng.h"
+#include "rng_functions.h"
 
-// Defines the buffer size and buffer holding the random values for the RNG.
-#define RNG_BUFFER_SIZE 1024 
-unsigned char rng_buffer[RNG_BUFFER_SIZE];
-int rng_buffer_idx = RNG_BUFFER_SIZE;  // Trigger refill on first use.
-int current_bit_idx = 8;  // Start at 8 to trigger byte fetch on first use.
-unsigned char current_byte = 0;  // Holds the byte from which bits are being extracted.
+// Context behind the global wrappers; its empty buffer triggers a refill on first use.
+rng_ctx global_rng = {.buffer_idx = RNG_BUFFER_SIZE, .bit_idx = 8};
 
 /**
- * This function refills the rng_buffer with random bytes.
- * It uses the 'randombytes' function to fill the buffer.
+ * This function refills the buffer of the RNG with random bytes.
+ * It uses the 'randombytes_r' function on the DRBG of the context to fill the buffer.
  */
-void refill_rng_buffer()
+void refill_rng_buffer_r(rng_ctx* rng)
 {
-    randombytes(rng_buffer, RNG_BUFFER_SIZE);
-    rng_buffer_idx = 0;
+    randombytes_r(&rng->drbg, rng->buffer, RNG_BUFFER_SIZE);
+    rng->buffer_idx = 0;
 }
 
 /**
  * This function provides a random bit.
  * 
  * When called, the function extracts the next bit from the current_byte.
- * If all bits from the current_byte have been used, it fetches the next byte from the rng_buffer.
- * When the rng_buffer is exhausted, it gets refilled with random bytes.
+ * If all bits from the current_byte have been used, it fetches the next byte from the buffer.
+ * When the buffer is exhausted, it gets refilled with random bytes.
  *
  * @return A random bit.
  */
-bool rng_bit()
+bool rng_bit_r(rng_ctx* rng)
 {
-    if(current_bit_idx == 8)  // All bits in the current byte are used
+    if(rng->bit_idx == 8)  // All bits in the current byte are used
     {
-        if(rng_buffer_idx == RNG_BUFFER_SIZE)  // If buffer is empty, refill
-        	refill_rng_buffer();
+        if(rng->buffer_idx == RNG_BUFFER_SIZE)  // If buffer is empty, refill
+        	refill_rng_buffer_r(rng);
         	
-        current_byte = rng_buffer[rng_buffer_idx];
-        current_bit_idx = 0;  // Reset bit index for the new byte
-        rng_buffer_idx++;     // Move to the next byte
+        rng->current_byte = rng->buffer[rng->buffer_idx];
+        rng->bit_idx = 0;     // Reset bit index for the new byte
+        rng->buffer_idx++;    // Move to the next byte
     }
 
-    bool bit = (current_byte & (1 << current_bit_idx)) != 0;
-    current_bit_idx++;
+    bool bit = (rng->current_byte & (1 << rng->bit_idx)) != 0;
+    rng->bit_idx++;
 
     return bit;
 }
 
 /**
  * This function provides a random byte.
- * Bytes are fetched from the rng_buffer.
+ * Bytes are fetched from the buffer.
  *
  * @return A random byte.
  */
-unsigned char rng_byte()
+unsigned char rng_byte_r(rng_ctx* rng)
 {
-    if(rng_buffer_idx == RNG_BUFFER_SIZE)  // If buffer is empty, refill
-    	refill_rng_buffer();
+    if(rng->buffer_idx == RNG_BUFFER_SIZE)  // If buffer is empty, refill
+    	refill_rng_buffer_r(rng);
     	
-    return rng_buffer[rng_buffer_idx++];
+    return rng->buffer[rng->buffer_idx++];
 }
 
 /**
  * This function provides a random +-1
  */
-int rng2()
+int rng2_r(rng_ctx* rng)
 {
-	return (rng_bit()==0)?1:-1;
+	return (rng_bit_r(rng)==0)?1:-1;
 }
 
 /**
  * This function provides a random number from [-hr, hr]/{0}. r is the range and hr is half of r.
  */
-int rngr(int r, int hr)
+int rngr_r(rng_ctx* rng, int r, int hr)
 {
-    int a = rng_byte() & (r - 1);   // Efficient random number in [0, r-1]
+    int a = rng_byte_r(rng) & (r - 1);   // Efficient random number in [0, r-1]
     int adjustment = (a >= hr);  // This will be 1 if a >= r/2, 0 otherwise
     return a - hr + adjustment;  // Shift to [-r/2, -1] or [1, r/2], excludes 0
 }
@@ -83,25 +80,171 @@ int rngr(int r, int hr)
  * This function initializes the RNG with a given seed.
  * It also resets the buffer and bit indices to trigger refilling the buffer and fetching a new byte on their next respective uses.
  *
+ * @param rng         The context to initialize.
  * @param seed        A pointer to the seed array.
  * @param seed_size   The size of the seed array.
  */
-void initialize_rng(unsigned char* seed, int seed_size)
+void initialize_rng_r(rng_ctx* rng, unsigned char* seed, int seed_size)
 {
-	randombytes_init(seed, NULL, 8*seed_size);
-    rng_buffer_idx = RNG_BUFFER_SIZE;
-	current_bit_idx = 8;
+	randombytes_init_r(&rng->drbg, seed, NULL, 8*seed_size);
+    rng->buffer_idx = RNG_BUFFER_SIZE;
+	rng->bit_idx = 8;
 }
 
 /**
- * This function zeros the rng_buffer and current_byte
+ * This function zeros the buffer, current_byte and DRBG state of the context
  */
-void clear_rng()
+void clear_rng_r(rng_ctx* rng)
 {
 	for(int i=0; i<RNG_BUFFER_SIZE; i++)
-		rng_buffer[i] = 0;
+		rng->buffer[i] = 0;
+	
+	rng->current_byte = 0;
+	memset(&rng->drbg, 0, sizeof(rng->drbg));
+	rng->buffer_idx = RNG_BUFFER_SIZE;
+	rng->bit_idx = 8;
+}
+
+/**
+ * This function provides n random bytes, equivalent to n calls of rng_byte_r.
+ */
+void rng_bytes_r(rng_ctx* rng, unsigned char* out, int n)
+{
+	while(n > 0)
+	{
+		if(rng->buffer_idx == RNG_BUFFER_SIZE)
+			refill_rng_buffer_r(rng);
+		
+		int chunk = RNG_BUFFER_SIZE - rng->buffer_idx;
+		if(chunk > n)
+			chunk = n;
+		
+		memcpy(out, rng->buffer + rng->buffer_idx, chunk);
+		rng->buffer_idx += chunk;
+		out += chunk;
+		n -= chunk;
+	}
+}
+
+/**
+ * This function provides n random numbers from [-hr, hr]/{0}, equivalent to n calls of rngr_r.
+ * Each chunk of the buffer is mapped in a single branch free loop.
+ */
+void rngr_bulk_r(rng_ctx* rng, int r, int hr, __int128* out, int n)
+{
+	while(n > 0)
+	{
+		if(rng->buffer_idx == RNG_BUFFER_SIZE)
+			refill_rng_buffer_r(rng);
+		
+		int chunk = RNG_BUFFER_SIZE - rng->buffer_idx;
+		if(chunk > n)
+			chunk = n;
+		
+		const unsigned char* in = rng->buffer + rng->buffer_idx;
+		
+		for(int i=0; i<chunk; i++)
+		{
+			int a = in[i] & (r - 1);
+			out[i] = a - hr + (a >= hr);
+		}
+		
+		rng->buffer_idx += chunk;
+		out += chunk;
+		n -= chunk;
+	}
+}
+
+/**
+ * This function draws 'rounds' repetitions of a pattern of bytes ('b', a value in [0, 255]) and signs ('s', +-1 as rng2_r).
+ * The draws are written to out in order and are identical to the corresponding sequence of rng_byte_r and rng2_r calls.
+ * When the buffer is known to hold enough bytes for the worst case, the draws are taken without any refill checks.
+ */
+void rng_draws_r(rng_ctx* rng, const char* pattern, int rounds, int* out)
+{
+	int len = strlen(pattern);
+	int bytes = 0;
+	
+	for(int p=0; p<len; p++)
+		bytes += pattern[p] == 'b';
+	
+	int signs = len - bytes;
+	int worst = rounds*bytes + (rounds*signs + 7)/8 + 1;
+	
+	if(RNG_BUFFER_SIZE - rng->buffer_idx < worst)
+	{
+		for(int r=0; r<rounds; r++)
+			for(int p=0; p<len; p++)
+				*out++ = pattern[p] == 'b' ? rng_byte_r(rng) : rng2_r(rng);
+		
+		return;
+	}
+	
+	const unsigned char* buffer = rng->buffer;
+	int idx = rng->buffer_idx;
+	int bit_idx = rng->bit_idx;
+	unsigned char current_byte = rng->current_byte;
+	
+	for(int r=0; r<rounds; r++)
+	{
+		for(int p=0; p<len; p++)
+		{
+			if(pattern[p] == 'b')
+			{
+				*out++ = buffer[idx++];
+			}
+			else
+			{
+				if(bit_idx == 8)
+				{
+					current_byte = buffer[idx++];
+					bit_idx = 0;
+				}
+				
+				*out++ = 1 - 2*((current_byte >> bit_idx) & 1);
+				bit_idx++;
+			}
+		}
+	}
 	
-	current_byte = 0;
+	rng->buffer_idx = idx;
+	rng->bit_idx = bit_idx;
+	rng->current_byte = current_byte;
+}
+
+void refill_rng_buffer()
+{
+	refill_rng_buffer_r(&global_rng);
+}
+
+bool rng_bit()
+{
+	return rng_bit_r(&global_rng);
+}
+
+unsigned char rng_byte()
+{
+	return rng_byte_r(&global_rng);
+}
+
+int rng2()
+{
+	return rng2_r(&global_rng);
+}
+
+int rngr(int r, int hr)
+{
+	return rngr_r(&global_rng, r, hr);
+}
+
+void initialize_rng(unsigned char* seed, int seed_size)
+{
+	initialize_rng_r(&global_rng, seed, seed_size);
+}
+
+void clear_rng()
+{
+	clear_rng_r(&global_rng);
 }
 
 
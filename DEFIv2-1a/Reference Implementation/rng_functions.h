@@ -2,7 +2,34 @@
 #define rng_functions_h
 
 #include <stdbool.h>
+#include "rng.h"
 
+// Defines the buffer size of the RNG.
+#define RNG_BUFFER_SIZE 1024
+
+// State of one RNG instance. Each thread of work owns its own, so concurrent users do not interfere.
+typedef struct {
+	AES256_CTR_DRBG_struct drbg;
+	unsigned char buffer[RNG_BUFFER_SIZE];
+	int buffer_idx;
+	int bit_idx;
+	unsigned char current_byte;
+} rng_ctx;
+
+void refill_rng_buffer_r(rng_ctx* rng);
+bool rng_bit_r(rng_ctx* rng);
+unsigned char rng_byte_r(rng_ctx* rng);
+int rng2_r(rng_ctx* rng);
+int rngr_r(rng_ctx* rng, int r, int hr);
+void initialize_rng_r(rng_ctx* rng, unsigned char* seed, int seed_size);
+void clear_rng_r(rng_ctx* rng);
+
+// Bulk samplers, consuming the same bytes and bits in the same order as the equivalent sequence of single draws
+void rng_bytes_r(rng_ctx* rng, unsigned char* out, int n);
+void rngr_bulk_r(rng_ctx* rng, int r, int hr, __int128* out, int n);
+void rng_draws_r(rng_ctx* rng, const char* pattern, int rounds, int* out);
+
+// Wrappers operating on a single global context (not thread-safe)
 void refill_rng_buffer(void);
 bool rng_bit(void);
 unsigned char rng_byte(void);
@@ -0,0 +1,214 @@
+#include <stdint.h>
+#include <string.h>
+#include "shake_functions.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define HAVE_AVX2_DISPATCH
+#endif
+
+enum { SHAKE_AUTO, SHAKE_PORTABLE, SHAKE_AVX2 };
+
+static int shake_impl = SHAKE_AUTO;
+
+#define SHAKE256_RATE 136
+
+// lane i of the Keccak state of input l is state[i][l], so every step of the permutation works on the four states at once
+typedef uint64_t keccak_x4_state[25][SHAKE_LANES];
+
+static const uint64_t KECCAK_RC[24] = {
+	0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+	0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+	0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+	0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+	0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+	0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+// rotation and destination lane of the combined rho and pi steps, following lane 1 around its cycle
+static const int KECCAK_ROTC[24] = {1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14, 27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44};
+static const int KECCAK_PILN[24] = {10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4, 15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1};
+
+#define ROL64(a, offset) (((a) << (offset)) ^ ((a) >> (64-(offset))))
+
+// Keccak-f[1600] on four states; inlined into each implementation so it is compiled for its instruction set
+static inline __attribute__((always_inline)) void keccak_x4_rounds(keccak_x4_state s)
+{
+	for(int round=0; round<24; round++)
+	{
+		uint64_t C[5][SHAKE_LANES];
+		uint64_t t[SHAKE_LANES];
+		
+		// theta
+		for(int x=0; x<5; x++)
+			for(int l=0; l<SHAKE_LANES; l++)
+				C[x][l] = s[x][l] ^ s[x+5][l] ^ s[x+10][l] ^ s[x+15][l] ^ s[x+20][l];
+		
+		for(int x=0; x<5; x++)
+			for(int l=0; l<SHAKE_LANES; l++)
+			{
+				uint64_t D = C[(x+4)%5][l] ^ ROL64(C[(x+1)%5][l], 1);
+				
+				for(int y=0; y<25; y+=5)
+					s[y+x][l] ^= D;
+			}
+		
+		// rho and pi
+		for(int l=0; l<SHAKE_LANES; l++)
+			t[l] = s[1][l];
+		
+		for(int j=0; j<24; j++)
+		{
+			int k = KECCAK_PILN[j];
+			
+			for(int l=0; l<SHAKE_LANES; l++)
+			{
+				uint64_t next = s[k][l];
+				s[k][l] = ROL64(t[l], KECCAK_ROTC[j]);
+				t[l] = next;
+			}
+		}
+		
+		// chi
+		for(int y=0; y<25; y+=5)
+		{
+			for(int x=0; x<5; x++)
+				for(int l=0; l<SHAKE_LANES; l++)
+					C[x][l] = s[y+x][l];
+			
+			for(int x=0; x<5; x++)
+				for(int l=0; l<SHAKE_LANES; l++)
+					s[y+x][l] = C[x][l] ^ (~C[(x+1)%5][l] & C[(x+2)%5][l]);
+		}
+		
+		// iota
+		for(int l=0; l<SHAKE_LANES; l++)
+			s[0][l] ^= KECCAK_RC[round];
+	}
+}
+
+static void keccak_x4_permute(keccak_x4_state s)
+{
+	keccak_x4_rounds(s);
+}
+
+#ifdef HAVE_AVX2_DISPATCH
+__attribute__((target("avx2")))
+static void keccak_x4_permute_avx2(keccak_x4_state s)
+{
+	keccak_x4_rounds(s);
+}
+#endif
+
+static int avx2_available(void)
+{
+#ifdef HAVE_AVX2_DISPATCH
+	return __builtin_cpu_supports("avx2");
+#else
+	return 0;
+#endif
+}
+
+static int current_impl(void)
+{
+	if(shake_impl != SHAKE_AUTO)
+		return shake_impl;
+	
+	return avx2_available() ? SHAKE_AVX2 : SHAKE_PORTABLE;
+}
+
+// xors a block of rate bytes into lane l of the states, little endian
+static void absorb_block(keccak_x4_state s, int l, const unsigned char* block)
+{
+	for(int i=0; i<SHAKE256_RATE/8; i++)
+	{
+		uint64_t w = 0;
+		
+		for(int b=7; b>=0; b--)
+			w = (w << 8) | block[8*i+b];
+		
+		s[i][l] ^= w;
+	}
+}
+
+static void squeeze_block(keccak_x4_state s, int l, unsigned char* out, int len)
+{
+	for(int i=0; i<len; i++)
+		out[i] = s[i/8][l] >> (8*(i%8));
+}
+
+// every lane absorbs its input block by block, permuting all the states after each step; a lane whose input is
+// shorter than the others is permuted needlessly once it is done, but its output has already been squeezed
+void shake256_x4(const unsigned char* const* inputs, const unsigned long long* input_lens, unsigned char* const* outputs, int output_len)
+{
+	keccak_x4_state s;
+	unsigned long long absorb_steps[SHAKE_LANES]; // the last block carries the padding
+	unsigned long long steps = 0;
+	int squeeze_steps = (output_len + SHAKE256_RATE - 1) / SHAKE256_RATE;
+	void (*permute)(keccak_x4_state) = keccak_x4_permute;
+	
+#ifdef HAVE_AVX2_DISPATCH
+	if(current_impl() == SHAKE_AVX2)
+		permute = keccak_x4_permute_avx2;
+#endif
+	
+	memset(s, 0, sizeof(s));
+	
+	for(int l=0; l<SHAKE_LANES; l++)
+	{
+		absorb_steps[l] = inputs[l] ? input_lens[l] / SHAKE256_RATE + 1 : 0;
+		
+		if(inputs[l] && absorb_steps[l] + squeeze_steps - 1 > steps)
+			steps = absorb_steps[l] + squeeze_steps - 1;
+	}
+	
+	for(unsigned long long step=0; step<steps; step++)
+	{
+		for(int l=0; l<SHAKE_LANES; l++)
+		{
+			if(step + 1 < absorb_steps[l])
+				absorb_block(s, l, inputs[l] + step*SHAKE256_RATE);
+			else if(step + 1 == absorb_steps[l])
+			{
+				unsigned char last[SHAKE256_RATE] = {0};
+				unsigned long long rest = input_lens[l] - step*SHAKE256_RATE;
+				
+				memcpy(last, inputs[l] + step*SHAKE256_RATE, rest);
+				last[rest] ^= 0x1F;
+				last[SHAKE256_RATE-1] ^= 0x80;
+				absorb_block(s, l, last);
+			}
+		}
+		
+		permute(s);
+		
+		for(int l=0; l<SHAKE_LANES; l++)
+		{
+			if(inputs[l] == NULL || step + 1 < absorb_steps[l] || step + 1 >= absorb_steps[l] + squeeze_steps)
+				continue;
+			
+			int offset = (step + 1 - absorb_steps[l]) * SHAKE256_RATE;
+			int len = output_len - offset < SHAKE256_RATE ? output_len - offset : SHAKE256_RATE;
+			
+			squeeze_block(s, l, outputs[l] + offset, len);
+		}
+	}
+}
+
+int shake_select(const char* name)
+{
+	if(strcmp(name, "auto") == 0)
+		shake_impl = SHAKE_AUTO;
+	else if(strcmp(name, "portable") == 0)
+		shake_impl = SHAKE_PORTABLE;
+	else if(strcmp(name, "avx2") == 0 && avx2_available())
+		shake_impl = SHAKE_AVX2;
+	else
+		return -1;
+	
+	return 0;
+}
+
+const char* shake_selected(void)
+{
+	return current_impl() == SHAKE_AVX2 ? "avx2" : "portable";
+}
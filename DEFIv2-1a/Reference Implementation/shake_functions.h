@@ -0,0 +1,15 @@
+#ifndef shake_functions_h
+#define shake_functions_h
+
+// number of inputs shake256_x4 hashes at once
+#define SHAKE_LANES 4
+
+// Computes SHAKE256 of up to four inputs at once on interleaved Keccak states, each output as FIPS202_SHAKE256 would
+// Lanes whose input is NULL are skipped; inputs may have different lengths
+void shake256_x4(const unsigned char* const* inputs, const unsigned long long* input_lens, unsigned char* const* outputs, int output_len);
+
+// Selects the permutation by name ("auto", "portable" or "avx2"); returns -1 if it is unavailable
+int shake_select(const char* name);
+const char* shake_selected(void);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef soa_functions_h
+#define soa_functions_h
+
+#include <stdbool.h>
+
+// Ring kernels over independent instances stored structure-of-arrays.
+// A soa polynomial holds one polynomial of each of lanes instances, coefficient-major:
+// coefficient k of instance t is poly[k*lanes+t], so every kernel loops over the instances innermost.
+// Soa vectors and matrices are arrays of soa polynomials, like the ring vectors and matrices of common_functions.h.
+// Results must not overlap the operands.
+
+__int128* allocate_soa_poly(int lanes);
+__int128** allocate_soa_vector(int n, int lanes);
+__int128*** allocate_soa_matrix(int m, int n, int lanes);
+void free_soa_vector(int n, __int128** A);
+void free_soa_matrix(int m, int n, __int128*** A);
+
+// copies the polynomials polys[0..count) to lanes 0..count of soa and zeroes the other lanes
+void soa_gather(int lanes, int count, __int128** polys, __int128* soa);
+// copies lanes 0..count of soa to the polynomials polys[0..count)
+void soa_scatter(int lanes, int count, const __int128* soa, __int128** polys);
+
+// product_in_ring for every instance
+void product_in_ring_soa(int lanes, const __int128* poly1, const __int128* poly2, __int128* result_poly, bool overwrite);
+// product_in_ring of the single polynomial poly1, shared by all instances, with each instance of poly2
+void product_in_ring_shared(int lanes, const __int128* poly1, const __int128* poly2, __int128* result_poly, bool overwrite);
+// rmv_multiply of the ring matrix A, shared by all instances, with each instance of b
+void rmv_multiply_soa(int m, int l, int lanes, __int128*** A, __int128** b, __int128** c);
+// rmm_multiply for every instance
+void rmm_multiply_soa(int m, int l, int n, int lanes, __int128*** A, __int128*** B, __int128*** C);
+// rdm_multiply for every instance
+void rdm_multiply_soa(int m, int n, int lanes, __int128** D, __int128*** A, __int128*** C);
+// c = a[0]*b[0] + ... + a[n-1]*b[n-1] for every instance, e.g. the quadratic form z^T*C*z with b = C*z
+void rvv_multiply_soa(int n, int lanes, __int128** a, __int128** b, __int128* c);
+
+#endif
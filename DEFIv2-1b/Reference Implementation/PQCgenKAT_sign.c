@@ -6,12 +6,19 @@ NIST-developed software is expressly provided "AS IS." NIST MAKES NO WARRANTY OF
 You are solely responsible for determining the appropriateness of using and distributing the software and you assume all risks associated with its use, including but not limited to the risks and costs of program errors, compliance with applicable laws, damage to or loss of data, programs or equipment, and the unavailability or interruption of operation. This software is not intended to be used in any situation where a failure could cause risk of injury or damage to property. The software developed by NIST employees is not subject to copyright protection within the United States.
 */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <unistd.h>
 #include "rng.h"
 #include "api.h"
+#include "pack_functions.h"
+#include "lht_functions.h"
+#include "shake_functions.h"
+#include "parallel_functions.h"
 
 #define	MAX_MARKER_LEN		50
 
@@ -23,11 +30,12 @@ You are solely responsible for determining the appropriateness of using and dist
 int		FindMarker(FILE *infile, const char *marker);
 int		ReadHex(FILE *infile, unsigned char *A, int Length, char *str);
 void	fprintBstr(FILE *fp, char *S, unsigned char *A, unsigned long long L);
+static int	kat_main(int argc, char **argv);
 
 char    AlgName[] = "DEFIv2-1";
 
 int
-main()
+main(int argc, char **argv)
 {
     char                fn_req[32], fn_rsp[32];
     FILE                *fp_req, *fp_rsp;
@@ -41,6 +49,9 @@ main()
     unsigned char       pk[CRYPTO_PUBLICKEYBYTES], sk[CRYPTO_SECRETKEYBYTES];
     int                 ret_val;
     
+    if ( argc > 1 )
+        return kat_main(argc, argv);
+    
     // Create the REQUEST file
     sprintf(fn_req, "PQCsignKAT_%d.req", CRYPTO_SECRETKEYBYTES);
     if ( (fp_req = fopen(fn_req, "w")) == NULL ) {
@@ -256,12 +267,23 @@ ReadHex(FILE *infile, unsigned char *A, int Length, char *str)
 void
 fprintBstr(FILE *fp, char *S, unsigned char *A, unsigned long long L)
 {
+	static const char	hex[] = "0123456789ABCDEF";
+	char				buf[512];
 	unsigned long long  i;
+	int					n = 0;
 
 	fprintf(fp, "%s", S);
 
-	for ( i=0; i<L; i++ )
-		fprintf(fp, "%02X", A[i]);
+	// hex is written a buffer at a time rather than one fprintf per byte
+	for ( i=0; i<L; i++ ) {
+		buf[n++] = hex[A[i] >> 4];
+		buf[n++] = hex[A[i] & 0xF];
+		if ( n == sizeof(buf) ) {
+			fwrite(buf, 1, n, fp);
+			n = 0;
+		}
+	}
+	fwrite(buf, 1, n, fp);
 
 	if ( L == 0 )
 		fprintf(fp, "00");
@@ -269,3 +291,642 @@ fprintBstr(FILE *fp, char *S, unsigned char *A, unsigned long long L)
 	fprintf(fp, "\n");
 }
 
+//
+// --verify and --extended: vectors are processed in batches on several threads, each vector with its own DRBG
+//
+
+#define KAT_MISMATCH        -5
+#define KAT_BATCH         1024
+#define KAT_STANDARD_COUNT 100
+
+typedef struct {
+    int                 count;
+    unsigned char       seed[48];
+    unsigned long long  mlen;
+    unsigned char       *msg;
+    unsigned char       pk[CRYPTO_PUBLICKEYBYTES];
+    unsigned char       sk[CRYPTO_SECRETKEYBYTES];
+    unsigned long long  smlen;
+    unsigned char       *sm;
+    size_t              capacity;   // bytes allocated for msg, and for sm beyond CRYPTO_BYTES
+    const char          *error;     // first check that failed, NULL if the vector is correct
+} kat_record;
+
+// line reader over a FILE, refilled a large block at a time
+typedef struct {
+    FILE    *fp;
+    char    *buf;
+    size_t  size;
+    size_t  start;  // first unread byte
+    size_t  end;    // end of the data read so far
+} kat_reader;
+
+static void
+kat_reserve(kat_record *rec, unsigned long long mlen)
+{
+    if ( mlen + 1 <= rec->capacity )
+        return;
+    
+    rec->capacity = mlen + 1;
+    rec->msg = realloc(rec->msg, rec->capacity);
+    rec->sm = realloc(rec->sm, rec->capacity + CRYPTO_BYTES);
+    if ( (rec->msg == NULL) || (rec->sm == NULL) ) {
+        printf("Memory Allocation Failure!");
+        exit(2);
+    }
+}
+
+// returns the next line, NUL terminated and without its line ending, or NULL at the end of the file
+static char *
+kat_read_line(kat_reader *r)
+{
+    for (;;) {
+        char *nl = memchr(r->buf + r->start, '\n', r->end - r->start);
+        
+        if ( (nl == NULL) && (r->start == r->end) && feof(r->fp) )
+            return NULL;
+        
+        if ( (nl == NULL) && feof(r->fp) ) {
+            // last line without a line ending; end < size is kept by the refill below
+            nl = r->buf + r->end;
+            r->end++;
+        }
+        
+        if ( nl != NULL ) {
+            char *line = r->buf + r->start;
+            
+            r->start = nl - r->buf + 1;
+            *nl = '\0';
+            if ( (nl > line) && (nl[-1] == '\r') )
+                nl[-1] = '\0';
+            
+            return line;
+        }
+        
+        // move the partial line to the front, growing the buffer if it fills all of it
+        memmove(r->buf, r->buf + r->start, r->end - r->start);
+        r->end -= r->start;
+        r->start = 0;
+        if ( r->end + 1 >= r->size ) {
+            r->size *= 2;
+            if ( (r->buf = realloc(r->buf, r->size)) == NULL ) {
+                printf("Memory Allocation Failure!");
+                exit(2);
+            }
+        }
+        r->end += fread(r->buf + r->end, 1, r->size - r->end - 1, r->fp);
+    }
+}
+
+static int
+kat_hex_value(char c)
+{
+    if ( (c >= '0') && (c <= '9') )
+        return c - '0';
+    if ( (c >= 'A') && (c <= 'F') )
+        return c - 'A' + 10;
+    if ( (c >= 'a') && (c <= 'f') )
+        return c - 'a' + 10;
+    return -1;
+}
+
+// decodes exactly L bytes of hex, printed as "00" by fprintBstr when L is 0
+static int
+kat_parse_hex(const char *str, unsigned char *A, unsigned long long L)
+{
+    if ( L == 0 )
+        return !strcmp(str, "00");
+    
+    if ( strlen(str) != 2*L )
+        return 0;
+    
+    for (unsigned long long i=0; i<L; i++) {
+        int hi = kat_hex_value(str[2*i]), lo = kat_hex_value(str[2*i+1]);
+        if ( (hi < 0) || (lo < 0) )
+            return 0;
+        A[i] = (hi << 4) | lo;
+    }
+    
+    return 1;
+}
+
+// reads the next "name = value" line, skipping blank lines and comments; returns 0 at the end of the file
+static int
+kat_read_field(kat_reader *r, const char *name, char **value)
+{
+    char *line;
+    size_t len = strlen(name);
+    
+    while ( (line = kat_read_line(r)) != NULL ) {
+        if ( (line[0] == '\0') || (line[0] == '#') )
+            continue;
+        
+        if ( strncmp(line, name, len) || strncmp(line + len, " = ", 3) ) {
+            printf("ERROR: expected '%s = ', found <%.40s>\n", name, line);
+            exit(KAT_DATA_ERROR);
+        }
+        
+        *value = line + len + 3;
+        return 1;
+    }
+    
+    return 0;
+}
+
+// reads the next vector of a .rsp file; returns 0 at the end of the file
+static int
+kat_read_record(kat_reader *r, kat_record *rec)
+{
+    char *value;
+    
+    if ( !kat_read_field(r, "count", &value) )
+        return 0;
+    rec->count = atoi(value);
+    
+    if ( !kat_read_field(r, "seed", &value) || !kat_parse_hex(value, rec->seed, 48) )
+        goto bad;
+    if ( !kat_read_field(r, "mlen", &value) )
+        goto bad;
+    rec->mlen = strtoull(value, NULL, 10);
+    kat_reserve(rec, rec->mlen);
+    if ( !kat_read_field(r, "msg", &value) || !kat_parse_hex(value, rec->msg, rec->mlen) )
+        goto bad;
+    if ( !kat_read_field(r, "pk", &value) || !kat_parse_hex(value, rec->pk, CRYPTO_PUBLICKEYBYTES) )
+        goto bad;
+    if ( !kat_read_field(r, "sk", &value) || !kat_parse_hex(value, rec->sk, CRYPTO_SECRETKEYBYTES) )
+        goto bad;
+    if ( !kat_read_field(r, "smlen", &value) )
+        goto bad;
+    rec->smlen = strtoull(value, NULL, 10);
+    if ( rec->smlen > rec->mlen + CRYPTO_BYTES )
+        goto bad;
+    if ( !kat_read_field(r, "sm", &value) || !kat_parse_hex(value, rec->sm, rec->smlen) )
+        goto bad;
+    
+    return 1;
+    
+bad:
+    printf("ERROR: malformed vector count = %d\n", rec->count);
+    exit(KAT_DATA_ERROR);
+}
+
+// computes the keypair and signed message of a vector from its seed and message, as main() does
+// through randombytes_init(seed) and crypto_sign_keypair, but on a DRBG of its own
+static const char *
+kat_compute(const kat_record *rec, unsigned char *pk, unsigned char *sk, unsigned char *sm, unsigned long long *smlen)
+{
+    AES256_CTR_DRBG_struct  drbg;
+    unsigned char           key_seed[48], seed[48];
+    unsigned char           *m1;
+    unsigned long long      mlen1;
+    const char              *error = NULL;
+    
+    memcpy(seed, rec->seed, 48);
+    randombytes_init_r(&drbg, seed, NULL, 256);
+    randombytes_r(&drbg, key_seed, 48);
+    
+    if ( crypto_sign_keypair_seeded(key_seed, pk, sk) != 0 )
+        return "crypto_sign_keypair";
+    if ( crypto_sign(sm, smlen, rec->msg, rec->mlen, sk) != 0 )
+        return "crypto_sign";
+    
+    if ( (m1 = malloc(rec->mlen + CRYPTO_BYTES)) == NULL ) {
+        printf("Memory Allocation Failure!");
+        exit(2);
+    }
+    if ( (crypto_sign_open(m1, &mlen1, sm, *smlen, pk) != 0) || (mlen1 != rec->mlen) || memcmp(m1, rec->msg, rec->mlen) )
+        error = "crypto_sign_open";
+    free(m1);
+    
+    return error;
+}
+
+// signs the message of a vector within a budget of one candidate: the signed message is that of the vector if the first
+// candidate is valid, and otherwise the call fails with *smlen = 0
+static int
+kat_verify_bounded(const kat_record *rec, const unsigned char *sk, unsigned char *sm)
+{
+    unsigned long long  smlen, attempts;
+    
+    if ( crypto_sign_bounded(sm, &smlen, rec->msg, rec->mlen, sk, 1, 1, 0, &attempts, NULL) == 0 )
+        return (attempts == 1) && (smlen == rec->smlen) && !memcmp(sm, rec->sm, smlen);
+    
+    return (attempts == 1) && (smlen == 0);
+}
+
+static void
+kat_verify_work(void *arg, int worker, int idx)
+{
+    kat_record          *rec = (kat_record *)arg + idx;
+    unsigned char       pk[CRYPTO_PUBLICKEYBYTES], sk[CRYPTO_SECRETKEYBYTES];
+    unsigned char       *sm = malloc(rec->mlen + CRYPTO_BYTES);
+    unsigned long long  smlen;
+    
+    if ( sm == NULL ) {
+        printf("Memory Allocation Failure!");
+        exit(2);
+    }
+    
+    if ( (rec->error = kat_compute(rec, pk, sk, sm, &smlen)) == NULL ) {
+        if ( memcmp(pk, rec->pk, CRYPTO_PUBLICKEYBYTES) )
+            rec->error = "pk";
+        else if ( memcmp(sk, rec->sk, CRYPTO_SECRETKEYBYTES) )
+            rec->error = "sk";
+        else if ( (smlen != rec->smlen) || memcmp(sm, rec->sm, smlen) )
+            rec->error = "sm";
+        else if ( !kat_verify_bounded(rec, sk, sm) )
+            rec->error = "crypto_sign_bounded";
+    }
+    
+    free(sm);
+}
+
+static void *
+kat_malloc(size_t size)
+{
+    void *p = malloc(size);
+    
+    if ( p == NULL ) {
+        printf("Memory Allocation Failure!");
+        exit(2);
+    }
+    
+    return p;
+}
+
+// opens the signed messages of a batch of vectors together through crypto_sign_open_batch, which must accept all of them
+static void
+kat_verify_open_batch(kat_record *batch, int n, int threads)
+{
+    const unsigned char **sms = kat_malloc(n * sizeof(unsigned char *));
+    const unsigned char **pks = kat_malloc(n * sizeof(unsigned char *));
+    unsigned long long  *smlens = kat_malloc(n * sizeof(unsigned long long));
+    unsigned char       *results = kat_malloc((n + 7) / 8);
+    
+    for (int i=0; i<n; i++) {
+        sms[i] = batch[i].sm;
+        smlens[i] = batch[i].smlen;
+        pks[i] = batch[i].pk;
+    }
+    
+    crypto_sign_open_batch(NULL, NULL, sms, smlens, pks, n, results, threads);
+    
+    for (int i=0; i<n; i++)
+        if ( (batch[i].error == NULL) && !(results[i/8] & (1 << (i%8))) )
+            batch[i].error = "crypto_sign_open_batch";
+    
+    free(sms);
+    free(pks);
+    free(smlens);
+    free(results);
+}
+
+// number of messages signed together under the key of each vector by kat_verify_sign_batch_work
+#define KAT_SIGN_BATCH 5
+
+typedef struct {
+    kat_record  *records;
+    int         n;
+} kat_batch;
+
+// signs the message of a vector and those of the vectors after it in one call to crypto_sign_batch, under the key of the
+// vector; the signed messages must be those of the vector and of crypto_sign, and crypto_sign_open_batch must accept them
+static void
+kat_verify_sign_batch_work(void *arg, int worker, int idx)
+{
+    kat_batch           *b = arg;
+    kat_record          *rec = &b->records[idx];
+    int                 count = b->n < KAT_SIGN_BATCH ? b->n : KAT_SIGN_BATCH;
+    const unsigned char *ms[KAT_SIGN_BATCH], *pks[KAT_SIGN_BATCH];
+    unsigned char       *sms[KAT_SIGN_BATCH], *sm, results[(KAT_SIGN_BATCH + 7) / 8];
+    unsigned long long  mlens[KAT_SIGN_BATCH], smlens[KAT_SIGN_BATCH], smlen, max_mlen = 0;
+    
+    if ( rec->error != NULL )
+        return;
+    
+    for (int j=0; j<count; j++) {
+        kat_record *other = &b->records[(idx + j) % b->n];
+        
+        ms[j] = other->msg;
+        mlens[j] = other->mlen;
+        sms[j] = kat_malloc(other->mlen + CRYPTO_BYTES);
+        pks[j] = rec->pk;
+        if ( other->mlen > max_mlen )
+            max_mlen = other->mlen;
+    }
+    sm = kat_malloc(max_mlen + CRYPTO_BYTES);
+    
+    if ( crypto_sign_batch(sms, smlens, ms, mlens, count, rec->sk, 1) != 0 )
+        rec->error = "crypto_sign_batch";
+    else if ( (smlens[0] != rec->smlen) || memcmp(sms[0], rec->sm, rec->smlen) )
+        rec->error = "crypto_sign_batch";
+    
+    for (int j=1; (j < count) && (rec->error == NULL); j++)
+        if ( (crypto_sign(sm, &smlen, ms[j], mlens[j], rec->sk) != 0) || (smlen != smlens[j]) || memcmp(sm, sms[j], smlen) )
+            rec->error = "crypto_sign_batch";
+    
+    if ( (rec->error == NULL) && (crypto_sign_open_batch(NULL, NULL, (const unsigned char *const *)sms, smlens, pks, count, results, 1) != 0) )
+        rec->error = "crypto_sign_open_batch of crypto_sign_batch";
+    
+    for (int j=0; j<count; j++)
+        free(sms[j]);
+    free(sm);
+}
+
+// signs the message of a vector in one call to crypto_sign_cosign under the key of the vector and those of the vectors after it;
+// each signature followed by the message must be the signed message of crypto_sign, and crypto_sign_cosign_open must accept
+// them and reject a signature with a bit flipped, one a byte short and one checked against another public key
+static void
+kat_verify_cosign_work(void *arg, int worker, int idx)
+{
+    kat_batch           *b = arg;
+    kat_record          *rec = &b->records[idx];
+    int                 count = b->n < KAT_SIGN_BATCH ? b->n : KAT_SIGN_BATCH;
+    int                 items = count + 2 + (b->n > 1);
+    const unsigned char *sks[KAT_SIGN_BATCH], *sigs[KAT_SIGN_BATCH + 3], *pks[KAT_SIGN_BATCH + 3];
+    unsigned char       *out[KAT_SIGN_BATCH], *sm, *flipped, results[(KAT_SIGN_BATCH + 3 + 7) / 8];
+    unsigned long long  siglens[KAT_SIGN_BATCH + 3], smlen;
+    
+    if ( rec->error != NULL )
+        return;
+    
+    for (int j=0; j<count; j++) {
+        kat_record *other = &b->records[(idx + j) % b->n];
+        
+        sks[j] = other->sk;
+        pks[j] = other->pk;
+        out[j] = kat_malloc(CRYPTO_BYTES);
+        sigs[j] = out[j];
+    }
+    sm = kat_malloc(rec->mlen + CRYPTO_BYTES);
+    flipped = kat_malloc(CRYPTO_BYTES);
+    
+    if ( crypto_sign_cosign(out, siglens, rec->msg, rec->mlen, sks, count, 1) != 0 )
+        rec->error = "crypto_sign_cosign";
+    
+    for (int j=0; (j < count) && (rec->error == NULL); j++)
+        if ( (crypto_sign(sm, &smlen, rec->msg, rec->mlen, sks[j]) != 0) || (smlen != siglens[j] + rec->mlen) || memcmp(sm, sigs[j], siglens[j]) )
+            rec->error = "crypto_sign_cosign";
+    
+    if ( rec->error == NULL ) {
+        memcpy(flipped, sigs[0], siglens[0]);
+        flipped[siglens[0] / 2] ^= 1;
+        sigs[count] = flipped;
+        siglens[count] = siglens[0];
+        pks[count] = pks[0];
+        
+        sigs[count + 1] = sigs[0];
+        siglens[count + 1] = siglens[0] - 1;
+        pks[count + 1] = pks[0];
+        
+        if ( b->n > 1 ) {
+            sigs[count + 2] = sigs[0];
+            siglens[count + 2] = siglens[0];
+            pks[count + 2] = b->records[(idx + 1) % b->n].pk;
+        }
+        
+        if ( crypto_sign_cosign_open(rec->msg, rec->mlen, sigs, siglens, pks, items, results, 1) != items - count )
+            rec->error = "crypto_sign_cosign_open";
+        for (int j=0; j<items; j++)
+            if ( !(results[j/8] & (1 << (j%8))) != (j >= count) )
+                rec->error = "crypto_sign_cosign_open";
+    }
+    
+    for (int j=0; j<count; j++)
+        free(out[j]);
+    free(sm);
+    free(flipped);
+}
+
+static void
+kat_generate_work(void *arg, int worker, int idx)
+{
+    kat_record *rec = (kat_record *)arg + idx;
+    
+    rec->error = kat_compute(rec, rec->pk, rec->sk, rec->sm, &rec->smlen);
+}
+
+static kat_record *
+kat_allocate_batch(void)
+{
+    kat_record *batch = calloc(KAT_BATCH, sizeof(kat_record));
+    
+    if ( batch == NULL ) {
+        printf("Memory Allocation Failure!");
+        exit(2);
+    }
+    
+    return batch;
+}
+
+static void
+kat_free_batch(kat_record *batch)
+{
+    for (int i=0; i<KAT_BATCH; i++) {
+        free(batch[i].msg);
+        free(batch[i].sm);
+    }
+    free(batch);
+}
+
+// checks every vector of an existing .rsp file against the implementation
+static int
+kat_verify(const char *fn_rsp, int threads)
+{
+    kat_reader  r;
+    kat_record  *batch = kat_allocate_batch();
+    kat_batch   b = { batch, 0 };
+    int         n, vectors = 0, failures = 0;
+    
+    if ( (r.fp = fopen(fn_rsp, "rb")) == NULL ) {
+        printf("Couldn't open <%s> for read\n", fn_rsp);
+        return KAT_FILE_OPEN_ERROR;
+    }
+    r.size = 1 << 20;
+    r.start = r.end = 0;
+    if ( (r.buf = malloc(r.size)) == NULL ) {
+        printf("Memory Allocation Failure!");
+        exit(2);
+    }
+    
+    do {
+        for (n=0; (n < KAT_BATCH) && kat_read_record(&r, &batch[n]); n++)
+            ;
+        
+        parallel_for(threads, n, kat_verify_work, batch);
+        kat_verify_open_batch(batch, n, threads);
+        b.n = n;
+        parallel_for(threads, n, kat_verify_sign_batch_work, &b);
+        parallel_for(threads, n, kat_verify_cosign_work, &b);
+        
+        for (int i=0; i<n; i++)
+            if ( batch[i].error != NULL ) {
+                printf("count = %d: %s does not match\n", batch[i].count, batch[i].error);
+                failures++;
+            }
+        vectors += n;
+    } while ( n == KAT_BATCH );
+    
+    printf("%s: %d vectors, %d failed\n", fn_rsp, vectors, failures);
+    
+    fclose(r.fp);
+    free(r.buf);
+    kat_free_batch(batch);
+    
+    if ( vectors == 0 )
+        return KAT_DATA_ERROR;
+    
+    return failures ? KAT_MISMATCH : KAT_SUCCESS;
+}
+
+// writes count vectors in the format of main(); the first 100 are those of PQCsignKAT_426.rsp, after which
+// the message lengths repeat, so the vectors stay small however many are generated
+static int
+kat_generate_extended(const char *fn_rsp, long long count, int threads)
+{
+    FILE                *fp_rsp;
+    kat_record          *batch = kat_allocate_batch();
+    unsigned char       entropy_input[48];
+    
+    if ( (fp_rsp = fopen(fn_rsp, "w")) == NULL ) {
+        printf("Couldn't open <%s> for write\n", fn_rsp);
+        return KAT_FILE_OPEN_ERROR;
+    }
+    
+    for (int i=0; i<48; i++)
+        entropy_input[i] = i;
+    randombytes_init(entropy_input, NULL, 256);
+    
+    fprintf(fp_rsp, "# %s\n\n", CRYPTO_ALGNAME);
+    
+    for (long long done=0; done<count; ) {
+        int n = (count - done < KAT_BATCH) ? (int)(count - done) : KAT_BATCH;
+        
+        // seeds and messages are drawn in the order of the request file of main()
+        for (int i=0; i<n; i++) {
+            kat_record *rec = &batch[i];
+            
+            rec->count = (int)(done + i);
+            rec->mlen = 33*((done + i) % KAT_STANDARD_COUNT + 1);
+            kat_reserve(rec, rec->mlen);
+            randombytes(rec->seed, 48);
+            randombytes(rec->msg, rec->mlen);
+        }
+        
+        parallel_for(threads, n, kat_generate_work, batch);
+        
+        for (int i=0; i<n; i++) {
+            kat_record *rec = &batch[i];
+            
+            if ( rec->error != NULL ) {
+                printf("%s failed for count = %d\n", rec->error, rec->count);
+                return KAT_CRYPTO_FAILURE;
+            }
+            
+            fprintf(fp_rsp, "count = %d\n", rec->count);
+            fprintBstr(fp_rsp, "seed = ", rec->seed, 48);
+            fprintf(fp_rsp, "mlen = %llu\n", rec->mlen);
+            fprintBstr(fp_rsp, "msg = ", rec->msg, rec->mlen);
+            fprintBstr(fp_rsp, "pk = ", rec->pk, CRYPTO_PUBLICKEYBYTES);
+            fprintBstr(fp_rsp, "sk = ", rec->sk, CRYPTO_SECRETKEYBYTES);
+            fprintf(fp_rsp, "smlen = %llu\n", rec->smlen);
+            fprintBstr(fp_rsp, "sm = ", rec->sm, rec->smlen);
+            fprintf(fp_rsp, "\n");
+        }
+        
+        done += n;
+    }
+    
+    fclose(fp_rsp);
+    kat_free_batch(batch);
+    
+    return KAT_SUCCESS;
+}
+
+// selects the implementation of a kernel, given as aes=<name>, pack=<name>, lht=<name> or shake=<name>
+static int
+kat_select(const char *choice)
+{
+    const char *name = strchr(choice, '=');
+    
+    if ( name == NULL )
+        return -1;
+    name++;
+    
+    if ( !strncmp(choice, "aes=", 4) )
+        return aes256_select(name);
+    if ( !strncmp(choice, "pack=", 5) )
+        return pack_select(name);
+    if ( !strncmp(choice, "lht=", 4) )
+        return lht_select(name);
+    if ( !strncmp(choice, "shake=", 6) )
+        return shake_select(name);
+    
+    return -1;
+}
+
+static int
+kat_usage(const char *name)
+{
+    printf("usage: %s                                writes PQCsignKAT_%d.req and .rsp\n", name, CRYPTO_SECRETKEYBYTES);
+    printf("       %s --verify [file.rsp] [options]  checks every vector of file.rsp (default PQCsignKAT_%d.rsp)\n", name, CRYPTO_SECRETKEYBYTES);
+    printf("       %s --extended count [file.rsp] [options]\n", name);
+    printf("                                         writes count vectors, the first 100 of which are the standard ones\n");
+    printf("options: -t threads                      (default: all online cores)\n");
+    printf("         -s aes=<name>|pack=<name>|lht=<name>|shake=<name>\n");
+    printf("                                         kernel implementation to use, as in aes256_select etc.\n");
+    return KAT_DATA_ERROR;
+}
+
+static int
+kat_main(int argc, char **argv)
+{
+    char        fn_rsp[64];
+    const char  *file = NULL;
+    long long   count = 0;
+    int         threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int         verify = !strcmp(argv[1], "--verify");
+    int         i = 2;
+    
+    if ( !verify && strcmp(argv[1], "--extended") )
+        return kat_usage(argv[0]);
+    
+    if ( !verify ) {
+        if ( (argc < 3) || ((count = atoll(argv[2])) < 1) )
+            return kat_usage(argv[0]);
+        i++;
+    }
+    
+    if ( (i < argc) && (argv[i][0] != '-') )
+        file = argv[i++];
+    
+    for (; i<argc; i++) {
+        if ( !strcmp(argv[i], "-t") && (i+1 < argc) )
+            threads = atoi(argv[++i]);
+        else if ( !strcmp(argv[i], "-s") && (i+1 < argc) ) {
+            if ( kat_select(argv[++i]) != 0 ) {
+                printf("ERROR: <%s> is not available\n", argv[i]);
+                return KAT_DATA_ERROR;
+            }
+        }
+        else
+            return kat_usage(argv[0]);
+    }
+    
+    if ( threads < 1 )
+        threads = 1;
+    
+    if ( verify ) {
+        if ( file == NULL ) {
+            sprintf(fn_rsp, "PQCsignKAT_%d.rsp", CRYPTO_SECRETKEYBYTES);
+            file = fn_rsp;
+        }
+        return kat_verify(file, threads);
+    }
+    
+    if ( file == NULL ) {
+        sprintf(fn_rsp, "PQCsignKAT_%d_%lld.rsp", CRYPTO_SECRETKEYBYTES, count);
+        file = fn_rsp;
+    }
+    return kat_generate_extended(file, count, threads);
+}
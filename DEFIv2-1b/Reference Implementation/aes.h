@@ -0,0 +1,20 @@
+#ifndef aes_h
+#define aes_h
+
+#include <stddef.h>
+
+// Expanded AES-256 key; the round keys are stored in FIPS-197 byte order, as used by every backend
+typedef struct {
+	unsigned char key[32];
+	unsigned char round_keys[15][16];
+} aes256_key;
+
+void aes256_key_expand(aes256_key* ks, const unsigned char* key);
+void aes256_encrypt_block(const aes256_key* ks, const unsigned char* in, unsigned char* out);
+void aes256_ctr_blocks(const aes256_key* ks, unsigned char* ctr, unsigned char* out, size_t blocks);
+
+// Selects the backend by name ("portable", "aesni" or "openssl"); returns -1 if it is unavailable
+int aes256_select(const char* name);
+const char* aes256_selected(void);
+
+#endif
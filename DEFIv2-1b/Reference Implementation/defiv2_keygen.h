@@ -1,6 +1,27 @@
 #ifndef defiv2_keygen_h
 #define defiv2_keygen_h
 
+#include <stdbool.h>
+#include "parameters.h"
+#include "rng_functions.h"
+
+// random draws of one attempt at B22 and B22^-1
+typedef struct {
+	int rounds[4*KB]; // for each round: permutation index, position, sign and the permutation index of the second step
+	__int128 x[M];
+	__int128 y[M];
+} B22_draws;
+
 int key_gen(unsigned char *pk, unsigned char *sk);
+int key_gen_seeded(const unsigned char *seed, unsigned char *pk, unsigned char *sk);
+int key_gen_mt(unsigned char *pk, unsigned char *sk, int threads);
+int key_gen_seeded_mt(const unsigned char *seed, unsigned char *pk, unsigned char *sk, int threads);
+
+void draw_B22(rng_ctx* rng, B22_draws* d);
+bool generate_B22(const B22_draws* d, __int128*** B22);
+bool valid_guessing_complexity(__int128*** B22);
+bool generate_B22inv(B22_draws* d, __int128*** B22inv);
+
+int key_gen_batch(const unsigned char *master_seed, int count, unsigned char *pks, unsigned char *sks, int threads);
 
 #endif
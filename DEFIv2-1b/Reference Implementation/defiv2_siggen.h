@@ -1,6 +1,25 @@
 #ifndef defiv2_siggen_h
 #define defiv2_siggen_h
 
+// limits of sig_gen_bounded; 0 for no limit
+typedef struct {
+	unsigned long long max_attempts; // candidates evaluated
+	unsigned long long max_ns;       // time taken
+} sig_budget;
+
+// what sig_gen_bounded did, whether or not it found a signature within its budget
+typedef struct {
+	unsigned long long attempts;     // candidates evaluated, up to and including the valid one
+	unsigned long long elapsed_ns;
+} sig_progress;
+
 int sig_gen(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk);
+int sig_gen_batch(unsigned char** sms, unsigned long long* smlens, const unsigned char* const* ms, const unsigned long long* mlens,
+	int count, const unsigned char* sk, int threads);
+int sig_gen_cosign(unsigned char** sigs, unsigned long long* siglens, const unsigned char* m, unsigned long long mlen,
+	const unsigned char* const* sks, int count, int threads);
+int sig_gen_bounded(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk,
+	int threads, const sig_budget* budget, sig_progress* progress);
+int sig_gen_mt(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk, int threads);
 
 #endif
@@ -1,166 +1,430 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include "parameters.h"
 #include "common_functions.h"
+#include "pack_functions.h"
+#include "parallel_functions.h"
+#include "soa_functions.h"
+#include "profile_functions.h"
+#include "defiv2_sigver.h"
+
+// number of items of a batch with the same public key verified as one task, all at once by sig_ver_lanes
+#define OPEN_BATCH_TASK SIG_VER_LANES
 
 // unpacks the public key into C
 void pk_to_C(const unsigned char* pk, __int128*** C)
 {
-	int total_bits = C1_BITS*M + C2_BITS*M*S + C3_BITS*M*N*S/2;
-    bool C_bits[total_bits];
-    
-    // pk to C_bits
-    int pkc = 0;
-    for(int i=0; i<total_bits; i+=8)
-    {
-    	for(int j=0; j<8; j++)
-    	   	C_bits[i+j] = (pk[pkc] >> j) & 1;
-    	   	
-    	pkc++;
-	}
+	__int128* polys[1 + (N-1) + N*(N-1)/2];
+	int p = 0;
 	
-	int bitc = 0;
-    	
-    // C1
-	for(int k=0; k<M; k++)
+	// C1 and C2
+	for(int j=0; j<N; j++)
+		polys[p++] = C[0][j];
+	
+	// C3
+	for(int i=1; i<N; i++)
+		for(int j=i; j<N; j++)
+			polys[p++] = C[i][j];
+	
+	PROFILE_BEGIN(PROFILE_UNPACK);
+	unpack_ring_polys(pk, PK_LAYOUT, 3, polys);
+	PROFILE_END(PROFILE_UNPACK);
+	
+	for(int i=0; i<N; i++)
+        for(int j=0; j<i; j++)
+			for(int k=0; k<M; k++)
+				C[i][j][k] = C[j][i][k];
+}
+
+void allocate_sig_ver_scratch(sig_ver_scratch* w, int lanes)
+{
+	w->C = allocate_ring_matrix(N, N);
+	w->H = allocate_ring_matrix(2, 2);
+	w->y = allocate_ring_vector(S);
+	w->z = allocate_ring_vector(N);
+	w->Cz = allocate_ring_vector(N);
+	w->lanes = lanes;
+	
+	if(lanes > 0)
 	{
-		__int128 val = 0;
-		
-		for(int bit=0; bit<C1_BITS; bit++)
-        	val |= (__int128)C_bits[bitc++] << bit;
-        
-        C[0][0][k] = val - C1_BOUND;
+		w->Hs = allocate_soa_vector(2, lanes);
+		w->zs = allocate_soa_vector(N, lanes);
+		w->Czs = allocate_soa_vector(N, lanes);
+		w->zCzs = allocate_soa_poly(lanes);
 	}
+}
+
+void free_sig_ver_scratch(sig_ver_scratch* w)
+{
+	free_ring_matrix(N, N, w->C); w->C = NULL;
+	free_ring_matrix(2, 2, w->H); w->H = NULL;
+	free_ring_vector(S, w->y); w->y = NULL;
+	free_ring_vector(N, w->z); w->z = NULL;
+	free_ring_vector(N, w->Cz); w->Cz = NULL;
 	
-	// C2
-	for(int j=1; j<N; j++)
+	if(w->lanes > 0)
 	{
-		for(int k=0; k<M; k++)
-		{
-			__int128 val = 0;
-		
-			for(int bit=0; bit<C2_BITS; bit++)
-	        	val |= (__int128)C_bits[bitc++] << bit;
-	        
-	        C[0][j][k] = val - C2_BOUND;
-		}
+		free_soa_vector(2, w->Hs); w->Hs = NULL;
+		free_soa_vector(N, w->zs); w->zs = NULL;
+		free_soa_vector(N, w->Czs); w->Czs = NULL;
+		free(w->zCzs); w->zCzs = NULL;
 	}
+}
+
+// unpacks y of the signature into w->y and hashes the message into w->H, in place in sm, then copies it to m unless m is NULL
+// returns false if the signature is malformed or y does not satisfy its bounds
+static bool sig_ver_prepare(unsigned char *m, unsigned long long *mlen, const unsigned char *sm, unsigned long long smlen, sig_ver_scratch* w)
+{
+	int smi = packed_bytes(SIG_LAYOUT, 1);
 	
-	//print_ring_matrix(N, N, C);
+	if(smlen < smi)
+		return false;
 	
-	// C3
-	for(int i=1; i<N; i++)
+	PROFILE_BEGIN(PROFILE_UNPACK);
+	bool y_valid = unpack_ring_polys(sm, SIG_LAYOUT, 1, w->y);
+	PROFILE_END(PROFILE_UNPACK);
+	
+	if(y_valid == false)
+		return false;
+	
+	unsigned long long message_len = smlen - smi;
+	
+	PROFILE_BEGIN(PROFILE_HASH);
+	hash_of_message(sm + smi, message_len, w->H);
+	PROFILE_END(PROFILE_HASH);
+	
+	if(m != NULL)
 	{
-		for(int j=i; j<N; j++)
-		{
-			for(int k=0; k<M; k++)
-			{
-				__int128 val = 0;
+		*mlen = message_len;
 		
-				for(int bit=0; bit<C3_BITS; bit++)
-			    	val |= (__int128)C_bits[bitc++] << bit;
-			    
-			    C[i][j][k] = val - C3_BOUND;
-			}
-		}
+		for(int i=0; i<message_len; i++)
+			m[i] = sm[smi+i];
 	}
 	
-	//print_ring_matrix(N, N, C);
+	return true;
+}
+
+// computes z[0] from the hash of the message; it does not depend on the public key
+static void message_z0(__int128*** H, __int128* z0)
+{
+	product_in_ring(H[0][0], H[1][1], z0, true);
+}
+
+// returns true if z*C*z = 0, for z and C in w
+static bool zCz_zero(sig_ver_scratch* w)
+{
+	__int128 zCz[M];
 	
+	PROFILE_BEGIN(PROFILE_ZCZ);
+	rmv_multiply(N, N, w->C, w->z, w->Cz);
+	zero_vector(M, zCz);
+
 	for(int i=0; i<N; i++)
-        for(int j=0; j<i; j++)
-			for(int k=0; k<M; k++)
-				C[i][j][k] = C[j][i][k];
+		product_in_ring(w->z[i], w->Cz[i], zCz, false);
+	PROFILE_END(PROFILE_ZCZ);
+	
+	for(int k=0; k<M; k++)
+		if(zCz[k]!=0)
+			return false;
+	
+	return true;
 }
 
-// unpacks the signature and message into y and m
-void sm_to_my(const unsigned char* sm, unsigned long long smlen, unsigned char* m, unsigned long long* mlen, __int128** y)
-{   
-	int total_bits = Y_BITS*S*M;
-	bool y_bits[total_bits];
-    
-    // sm to bits
-    int smi = 0;
-    for(int i=0; i<total_bits; i+=8)
-    {
-    	for(int j=0; j<8; j++)
-    	   	y_bits[i+j] = (sm[smi] >> j) & 1;
-    	   	
-    	smi++;
-	}
-	
-	int idx = 0;
+// DEFIv2 signature verification against the public key already unpacked into w->C
+int sig_ver_unpacked(unsigned char *m, unsigned long long *mlen, const unsigned char *sm, unsigned long long smlen, sig_ver_scratch* w)
+{
+	if(sig_ver_prepare(m, mlen, sm, smlen, w) == false)
+		return -1; // Verification Unsuccessfull
 	
-	// y	
+	__int128** z = w->z;
+	message_z0(w->H, z[0]);
+			
 	for(int i=0; i<S; i++)
+		for(int k=0; k<M; k++)
+			z[R+i][k] = w->y[i][k];
+	
+	if(zCz_zero(w) == false)
+		return -1; // Verification Unsuccessfull
+
+	return 0; // Verification Successfull	
+}
+
+// DEFIv2 signature verification
+int sig_ver(unsigned char *m, unsigned long long *mlen, const unsigned char *sm, unsigned long long smlen, const unsigned char *pk)
+{
+	sig_ver_scratch w;
+	allocate_sig_ver_scratch(&w, 0);
+	
+	pk_to_C(pk, w.C);
+	int ret = sig_ver_unpacked(m, mlen, sm, smlen, &w);
+	
+	free_sig_ver_scratch(&w);
+	
+	return ret;
+}
+
+// verifies count <= w->lanes signed messages against the public key already unpacked into w->C, each one an instance of the soa kernels
+// sets valid[t] to sig_ver_unpacked(ms[t], mlens[t], sms[t], smlens[t], w) == 0; ms[t] may be NULL
+void sig_ver_lanes(int count, unsigned char** ms, unsigned long long** mlens, const unsigned char** sms, const unsigned long long* smlens,
+	sig_ver_scratch* w, bool* valid)
+{
+	int lanes = count;
+	
+	for(int t=0; t<count; t++)
 	{
+		valid[t] = sig_ver_prepare(ms[t], mlens[t], sms[t], smlens[t], w);
+		
+		// a malformed item stays in its lane with z = 0, and is rejected whatever its zCz
 		for(int k=0; k<M; k++)
 		{
-			__int128 val = 0;
-		
-			for(int bit=0; bit<Y_BITS; bit++)
-	        	val |= (__int128)y_bits[idx++] << bit;
-	        
-	        y[i][k] = val - Y_BOUND;
+			// H is diagonal, so z0 only needs H[0][0] and H[1][1]
+			w->Hs[0][k*lanes+t] = valid[t] ? w->H[0][0][k] : 0;
+			w->Hs[1][k*lanes+t] = valid[t] ? w->H[1][1][k] : 0;
+			
+			for(int i=0; i<S; i++)
+				w->zs[R+i][k*lanes+t] = valid[t] ? w->y[i][k] : 0;
 		}
 	}
-    
-    *mlen = smlen - smi;
-    
-    for(int i=0; i<*mlen; i++)
-		m[i] = sm[smi+i];
+	
+	product_in_ring_soa(lanes, w->Hs[0], w->Hs[1], w->zs[0], true);
+	
+	PROFILE_BEGIN(PROFILE_ZCZ);
+	rmv_multiply_soa(N, N, lanes, w->C, w->zs, w->Czs);
+	rvv_multiply_soa(N, lanes, w->zs, w->Czs, w->zCzs);
+	PROFILE_END(PROFILE_ZCZ);
+	
+	for(int k=0; k<M; k++)
+		for(int t=0; t<lanes; t++)
+			if(w->zCzs[k*lanes+t]!=0)
+				valid[t] = false;
 }
 
+// items of a batch, in the order in which they are verified
+typedef struct {
+	unsigned char** ms;
+	unsigned long long* mlens;
+	const unsigned char* const* sms;
+	const unsigned long long* smlens;
+	const unsigned char* const* pks;
+	int* order;            // item indices sorted by public key
+	int* task_start;       // first position in order of each task; a task covers items with the same public key
+	bool* valid;           // result of each item
+	sig_ver_scratch* scratch; // one per worker
+} open_batch;
 
-// DEFIv2 signature verification
-int sig_ver(unsigned char *m, unsigned long long *mlen, const unsigned char *sm, unsigned long long smlen, const unsigned char *pk)
+// an item of a batch with its public key, as sorted by compare_pks
+typedef struct {
+	const unsigned char* pk;
+	int idx;
+} open_batch_key;
+
+// orders by public key, then by index so that the order is the same on every platform
+static int compare_pks(const void* a, const void* b)
 {
-	__int128*** C = allocate_ring_matrix(N, N);
-	pk_to_C(pk, C);
+	const open_batch_key* x = a;
+	const open_batch_key* y = b;
+	int c = x->pk == y->pk ? 0 : memcmp(x->pk, y->pk, packed_bytes(PK_LAYOUT, 3));
 	
-	__int128** y = allocate_ring_vector(S);
-	sm_to_my(sm, smlen, m, mlen, y);
+	return c != 0 ? c : (x->idx > y->idx) - (x->idx < y->idx);
+}
+
+// sets bit i%8 of results[i/8] for each valid item i, and returns the number of invalid items
+static int pack_results(int count, const bool* valid, unsigned char* results)
+{
+	int invalid = 0;
+	memset(results, 0, (count+7)/8);
 	
-	if(valid_y(y) == false)
-		return -1; // Verification Unsuccessfull
+	for(int i=0; i<count; i++)
+	{
+		if(valid[i])
+			results[i/8] |= 1 << (i%8);
+		else
+			invalid++;
+	}
+	
+	return invalid;
+}
+
+static void open_batch_task(void* arg, int worker, int task)
+{
+	open_batch* b = arg;
+	sig_ver_scratch* w = &b->scratch[worker];
+	
+	int first = b->task_start[task];
+	int count = b->task_start[task+1] - first;
+	unsigned char* ms[OPEN_BATCH_TASK];
+	unsigned long long* mlens[OPEN_BATCH_TASK];
+	const unsigned char* sms[OPEN_BATCH_TASK];
+	unsigned long long smlens[OPEN_BATCH_TASK];
+	bool valid[OPEN_BATCH_TASK];
+	
+	for(int t=0; t<count; t++)
+	{
+		int i = b->order[first+t];
+		ms[t] = b->ms ? b->ms[i] : NULL;
+		mlens[t] = b->ms ? &b->mlens[i] : NULL;
+		sms[t] = b->sms[i];
+		smlens[t] = b->smlens[i];
+	}
+	
+	// the public key is unpacked once for all the items of the task
+	pk_to_C(b->pks[b->order[first]], w->C);
+	sig_ver_lanes(count, ms, mlens, sms, smlens, w, valid);
+	
+	for(int t=0; t<count; t++)
+		b->valid[b->order[first+t]] = valid[t];
+}
+
+// verifies count signed messages on the given number of threads; item i is sms[i] under pks[i]
+// bit i%8 of results[i/8] is set if item i is valid; returns the number of invalid items
+int sig_ver_batch(unsigned char** ms, unsigned long long* mlens, const unsigned char* const* sms, const unsigned long long* smlens,
+	const unsigned char* const* pks, int count, unsigned char* results, int threads)
+{
+	if(threads < 1)
+		threads = 1;
+	
+	if(count <= 0)
+		return 0;
+	
+	open_batch b = {ms, mlens, sms, smlens, pks};
+	b.order = allocate_memory(count*sizeof(int));
+	b.task_start = allocate_memory((count+1)*sizeof(int));
+	b.valid = allocate_memory(count*sizeof(bool));
+	
+	open_batch_key* keys = allocate_memory(count*sizeof(open_batch_key));
+	
+	for(int i=0; i<count; i++)
+		keys[i] = (open_batch_key){pks[i], i};
+	
+	qsort(keys, count, sizeof(open_batch_key), compare_pks);
+	
+	for(int i=0; i<count; i++)
+		b.order[i] = keys[i].idx;
+	
+	free(keys);
+	
+	// runs of the same key are split into tasks of at most OPEN_BATCH_TASK items
+	int tasks = 0;
+	
+	for(int p=0; p<count; p++)
+	{
+		bool same_key = p > 0 && p - b.task_start[tasks-1] < OPEN_BATCH_TASK &&
+			memcmp(pks[b.order[p]], pks[b.order[p-1]], packed_bytes(PK_LAYOUT, 3)) == 0;
 		
-	__int128*** H = allocate_ring_matrix(2,2);
-	hash_of_message(m, *mlen, H);
+		if(!same_key)
+			b.task_start[tasks++] = p;
+	}
 	
-	__int128 v1v4[M];
-	product_in_ring(H[0][0], H[1][1], v1v4, true);
+	b.task_start[tasks] = count;
 	
-	free_ring_matrix(2, 2, H); H = NULL;
+	if(threads > tasks)
+		threads = tasks;
 	
-	__int128** z = allocate_ring_vector(N);	
+	b.scratch = allocate_memory(threads*sizeof(sig_ver_scratch));
+	for(int t=0; t<threads; t++)
+		allocate_sig_ver_scratch(&b.scratch[t], OPEN_BATCH_TASK);
 	
-	for(int k=0; k<M; k++)
-		z[0][k] = v1v4[k];
-			
-	for(int i=0; i<S; i++)
-		for(int k=0; k<M; k++)
-			z[R+i][k] = y[i][k];
+	parallel_steal(threads, tasks, open_batch_task, &b);
+	int invalid = pack_results(count, b.valid, results);
+	
+	for(int t=0; t<threads; t++)
+		free_sig_ver_scratch(&b.scratch[t]);
 	
-	free_ring_vector(S, y); y = NULL;
+	free(b.scratch);
+	free(b.order);
+	free(b.task_start);
+	free(b.valid);
 	
-	__int128** Cz = allocate_ring_vector(N);
-	rmv_multiply(N, N, C, z, Cz);
+	return invalid;
+}
 
-	__int128 zCz[M];
-	zero_vector(M, zCz);
+// signatures of one message by several public keys, one task each
+typedef struct {
+	const unsigned char* const* sigs;
+	const unsigned long long* siglens;
+	const unsigned char* const* pks;
+	__int128* z0;
+	bool* valid;              // result of each signature
+	sig_ver_scratch* scratch; // one per worker
+} cosign_open_job;
 
-	for(int i=0; i<N; i++)
-		product_in_ring(z[i], Cz[i], zCz, false);
+static void cosign_open_task(void* arg, int worker, int i)
+{
+	cosign_open_job* job = arg;
+	sig_ver_scratch* w = &job->scratch[worker];
+	
+	// a signature is y alone; anything after it would be taken as part of the message by sig_ver
+	if(job->siglens[i] != packed_bytes(SIG_LAYOUT, 1))
+	{
+		job->valid[i] = false;
+		return;
+	}
+	
+	PROFILE_BEGIN(PROFILE_UNPACK);
+	bool y_valid = unpack_ring_polys(job->sigs[i], SIG_LAYOUT, 1, w->y);
+	PROFILE_END(PROFILE_UNPACK);
+	
+	if(y_valid == false)
+	{
+		job->valid[i] = false;
+		return;
+	}
 	
-	free_ring_matrix(N, N, C); C = NULL;
-	free_ring_vector(N, z); z = NULL;
-	free_ring_vector(N, Cz); Cz = NULL;
+	pk_to_C(job->pks[i], w->C);
 	
 	for(int k=0; k<M; k++)
-		if(zCz[k]!=0)
-			return -1; // Verification Unsuccessfull
-
-	return 0; // Verification Successfull	
+		w->z[0][k] = job->z0[k];
+	
+	for(int j=0; j<S; j++)
+		for(int k=0; k<M; k++)
+			w->z[R+j][k] = w->y[j][k];
+	
+	job->valid[i] = zCz_zero(w);
 }
 
+// verifies count signatures of one message on the given number of threads; signature i is sigs[i] under pks[i]
+// the message is hashed and z[0] computed once for all of them
+// bit i%8 of results[i/8] is set if signature i is valid; returns the number of invalid signatures
+int sig_ver_cosign(const unsigned char* m, unsigned long long mlen, const unsigned char* const* sigs, const unsigned long long* siglens,
+	const unsigned char* const* pks, int count, unsigned char* results, int threads)
+{
+	if(threads < 1)
+		threads = 1;
+	
+	if(count <= 0)
+		return 0;
+	
+	if(threads > count)
+		threads = count;
+	
+	__int128*** H = allocate_ring_matrix(2, 2);
+	__int128 z0[M];
+	
+	PROFILE_BEGIN(PROFILE_HASH);
+	hash_of_message(m, mlen, H);
+	PROFILE_END(PROFILE_HASH);
+	message_z0(H, z0);
+	
+	cosign_open_job job = {sigs, siglens, pks, z0};
+	job.valid = allocate_memory(count*sizeof(bool));
+	job.scratch = allocate_memory(threads*sizeof(sig_ver_scratch));
+	
+	for(int t=0; t<threads; t++)
+		allocate_sig_ver_scratch(&job.scratch[t], 0);
+	
+	parallel_steal(threads, count, cosign_open_task, &job);
+	int invalid = pack_results(count, job.valid, results);
+	
+	for(int t=0; t<threads; t++)
+		free_sig_ver_scratch(&job.scratch[t]);
+	
+	free(job.scratch);
+	free(job.valid);
+	free_ring_matrix(2, 2, H); H = NULL;
+	
+	return invalid;
+}
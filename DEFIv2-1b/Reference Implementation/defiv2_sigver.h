@@ -1,6 +1,35 @@
 #ifndef defiv2_sigver_h
 #define defiv2_sigver_h
 
+#include <stdbool.h>
+
+// largest number of signed messages sig_ver_lanes verifies at once
+#define SIG_VER_LANES 8
+
+// working memory of a verification, reused across the items of a batch
+typedef struct {
+	__int128*** C;  // the unpacked public key
+	__int128*** H;
+	__int128** y;
+	__int128** z;
+	__int128** Cz;
+	int lanes;      // instances of the soa polynomials below (see soa_functions.h); 0 if they are not allocated
+	__int128** Hs;  // the entries of H that z0 depends on, as allocated by the variant
+	__int128** zs;
+	__int128** Czs;
+	__int128* zCzs;
+} sig_ver_scratch;
+
+void allocate_sig_ver_scratch(sig_ver_scratch* w, int lanes);
+void free_sig_ver_scratch(sig_ver_scratch* w);
+void pk_to_C(const unsigned char* pk, __int128*** C);
+int sig_ver_unpacked(unsigned char *m, unsigned long long *mlen, const unsigned char *sm, unsigned long long smlen, sig_ver_scratch* w);
+void sig_ver_lanes(int count, unsigned char** ms, unsigned long long** mlens, const unsigned char** sms, const unsigned long long* smlens,
+	sig_ver_scratch* w, bool* valid);
+int sig_ver_batch(unsigned char** ms, unsigned long long* mlens, const unsigned char* const* sms, const unsigned long long* smlens,
+	const unsigned char* const* pks, int count, unsigned char* results, int threads);
+int sig_ver_cosign(const unsigned char* m, unsigned long long mlen, const unsigned char* const* sigs, const unsigned long long* siglens,
+	const unsigned char* const* pks, int count, unsigned char* results, int threads);
 int sig_ver(unsigned char *m, unsigned long long *mlen, const unsigned char *sm, unsigned long long smlen, const unsigned char *pk);
 
 #endif
@@ -0,0 +1,203 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include "parameters.h"
+#include "common_functions.h"
+#include "pack_functions.h"
+#include "defiv2_keygen.h"
+#include "keypool_functions.h"
+
+struct keypair_pool {
+	int depth;
+	int pk_bytes;
+	int sk_bytes;
+	unsigned char* pks;              // ring buffer of depth keypairs
+	unsigned char* sks;
+	int head;                        // slot of the oldest keypair
+	int count;                       // keypairs in the ring buffer
+	int pending;                     // keypairs being generated by the background threads
+	unsigned long long* empty_since; // queue of the times the empty slots became empty, oldest first
+	int empty_head;
+	keypair_pool_stats stats;
+	bool stop;
+	pthread_mutex_t lock;
+	pthread_cond_t refill;           // signalled whenever the pool has room or is shutting down
+	int threads;
+	pthread_t* tid;
+};
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// the empty slots are depth - count; the time the oldest of them became empty is at empty_head
+static void push_empty(keypair_pool* pool, unsigned long long t)
+{
+	int empty = pool->depth - pool->count;
+	
+	pool->empty_since[(pool->empty_head + empty - 1) % pool->depth] = t;
+}
+
+static unsigned long long pop_empty(keypair_pool* pool)
+{
+	unsigned long long t = pool->empty_since[pool->empty_head];
+	
+	pool->empty_head = (pool->empty_head + 1) % pool->depth;
+	
+	return t;
+}
+
+// generates keypairs on a background thread until the pool is destroyed, keeping it filled to its depth
+static void* keypair_pool_refill(void* arg)
+{
+	keypair_pool* pool = arg;
+	unsigned char* pk = allocate_memory(pool->pk_bytes);
+	unsigned char* sk = allocate_memory(pool->sk_bytes);
+	
+	pthread_mutex_lock(&pool->lock);
+	
+	while(1)
+	{
+		while(!pool->stop && pool->count + pool->pending >= pool->depth)
+			pthread_cond_wait(&pool->refill, &pool->lock);
+		
+		if(pool->stop)
+			break;
+		
+		pool->pending++;
+		pthread_mutex_unlock(&pool->lock);
+		
+		key_gen(pk, sk);
+		
+		pthread_mutex_lock(&pool->lock);
+		pool->pending--;
+		
+		int slot = (pool->head + pool->count) % pool->depth;
+		memcpy(pool->pks + (size_t)slot*pool->pk_bytes, pk, pool->pk_bytes);
+		memcpy(pool->sks + (size_t)slot*pool->sk_bytes, sk, pool->sk_bytes);
+		
+		unsigned long long lag = now_ns() - pop_empty(pool);
+		pool->count++;
+		pool->stats.refills++;
+		pool->stats.lag_total_ns += lag;
+		if(lag > pool->stats.lag_max_ns)
+			pool->stats.lag_max_ns = lag;
+	}
+	
+	pthread_mutex_unlock(&pool->lock);
+	
+	secure_zero(sk, pool->sk_bytes);
+	free(pk);
+	free(sk);
+	
+	return NULL;
+}
+
+// creates a pool holding up to depth keypairs, refilled by the given number of background threads
+keypair_pool* keypair_pool_create(int depth, int threads)
+{
+	if(depth < 1)
+		depth = 1;
+	if(threads < 1)
+		threads = 1;
+	
+	keypair_pool* pool = allocate_memory(sizeof(keypair_pool));
+	memset(pool, 0, sizeof(keypair_pool));
+	
+	pool->depth = depth;
+	pool->pk_bytes = packed_bytes(PK_LAYOUT, 3);
+	pool->sk_bytes = 48 + packed_bytes(SK_LAYOUT, 1);
+	pool->pks = allocate_memory((size_t)depth*pool->pk_bytes);
+	pool->sks = allocate_memory((size_t)depth*pool->sk_bytes);
+	pool->empty_since = allocate_memory(depth*sizeof(unsigned long long));
+	
+	unsigned long long t = now_ns();
+	for(int i=0; i<depth; i++)
+		pool->empty_since[i] = t;
+	
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->refill, NULL);
+	
+	pool->threads = threads;
+	pool->tid = allocate_memory(threads*sizeof(pthread_t));
+	
+	for(int i=0; i<threads; i++)
+	{
+		if(pthread_create(&pool->tid[i], NULL, keypair_pool_refill, pool) != 0)
+		{
+			printf("Thread Creation Failure!");
+			exit(2);
+		}
+	}
+	
+	return pool;
+}
+
+// hands out the oldest keypair of the pool; if the pool is empty, a keypair is generated on the calling thread
+int keypair_pool_take(keypair_pool* pool, unsigned char* pk, unsigned char* sk)
+{
+	pthread_mutex_lock(&pool->lock);
+	
+	if(pool->count == 0)
+	{
+		pool->stats.misses++;
+		pthread_mutex_unlock(&pool->lock);
+		
+		return key_gen(pk, sk);
+	}
+	
+	unsigned char* slot_sk = pool->sks + (size_t)pool->head*pool->sk_bytes;
+	memcpy(pk, pool->pks + (size_t)pool->head*pool->pk_bytes, pool->pk_bytes);
+	memcpy(sk, slot_sk, pool->sk_bytes);
+	memset(slot_sk, 0, pool->sk_bytes);
+	
+	pool->head = (pool->head + 1) % pool->depth;
+	pool->count--;
+	push_empty(pool, now_ns());
+	pool->stats.hits++;
+	
+	pthread_cond_signal(&pool->refill);
+	pthread_mutex_unlock(&pool->lock);
+	
+	return 0;
+}
+
+void keypair_pool_get_stats(keypair_pool* pool, keypair_pool_stats* stats)
+{
+	pthread_mutex_lock(&pool->lock);
+	*stats = pool->stats;
+	stats->available = pool->count;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+// stops the background threads, waiting for keypairs being generated, and zeroizes the unused keys
+void keypair_pool_destroy(keypair_pool* pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = true;
+	pthread_cond_broadcast(&pool->refill);
+	pthread_mutex_unlock(&pool->lock);
+	
+	for(int i=0; i<pool->threads; i++)
+		pthread_join(pool->tid[i], NULL);
+	
+	secure_zero(pool->sks, (size_t)pool->depth*pool->sk_bytes);
+	
+	pthread_cond_destroy(&pool->refill);
+	pthread_mutex_destroy(&pool->lock);
+	
+	free(pool->pks);
+	free(pool->sks);
+	free(pool->empty_since);
+	free(pool->tid);
+	free(pool);
+}
@@ -0,0 +1,21 @@
+#ifndef keypool_functions_h
+#define keypool_functions_h
+
+// pool of keypairs generated ahead of time by background threads with key_gen
+typedef struct keypair_pool keypair_pool;
+
+typedef struct {
+	unsigned long long hits;          // keypairs handed out from the pool
+	unsigned long long misses;        // keypairs generated on the calling thread because the pool was empty
+	unsigned long long refills;       // keypairs added to the pool by the background threads
+	unsigned long long lag_total_ns;  // sum over refills of the time the refilled slot was empty
+	unsigned long long lag_max_ns;    // longest time a slot was empty before it was refilled
+	int available;                    // keypairs currently in the pool
+} keypair_pool_stats;
+
+keypair_pool* keypair_pool_create(int depth, int threads);
+int keypair_pool_take(keypair_pool* pool, unsigned char* pk, unsigned char* sk);
+void keypair_pool_get_stats(keypair_pool* pool, keypair_pool_stats* stats);
+void keypair_pool_destroy(keypair_pool* pool);
+
+#endif
@@ -0,0 +1,201 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include "parameters.h"
+#include "lht_functions.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_AVX2_DISPATCH
+#endif
+
+enum { LHT_AUTO, LHT_PORTABLE, LHT_AVX2 };
+
+static int lht_impl = LHT_AUTO;
+
+// number of values in a row of LHT, one for each coefficient in [-B22_BOUND+1, B22_BOUND-1]
+#define LHT_ROW (B22_BOUND * 2 - 1)
+#define LHT_ROWS (S * S * M)
+
+// rows are split into blocks of 2^LHT_BLOCK_BITS values, stored as LHT_OFFSET_BITS-bit offsets from the minimum of their block
+#define LHT_BLOCK_BITS 5
+#define LHT_BLOCKS ((LHT_ROW >> LHT_BLOCK_BITS) + 1)
+#define LHT_OFFSET_BITS 3
+#define LHT_OFFSET_BYTES ((LHT_ROW * LHT_OFFSET_BITS + 7) / 8)
+
+// offset of a value too far above the minimum of its block, which is then read from LHT itself
+#define LHT_ESCAPE ((1 << LHT_OFFSET_BITS) - 1)
+
+#ifdef LHT_BOOTSTRAP
+// building lht_generator, which must not depend on a table for the current parameters
+static const char LHT[S][S][M][LHT_ROW];
+#else
+#include "lht_table.h"
+#endif
+
+// compact form of LHT, built from it on first use: about 26 KB instead of 64 KB, so that it stays resident in a 32 KB L1
+// data cache; 4 bit offsets would take 33 KB
+// an offset is read as the 16 or 32 bits from its first byte, and the padding keeps those of the last entries within the struct
+static struct {
+	unsigned char offsets[LHT_ROWS][LHT_OFFSET_BYTES];
+	unsigned char base[LHT_ROWS][LHT_BLOCKS];
+	unsigned char pad[4];
+} lht;
+
+static pthread_once_t lht_once = PTHREAD_ONCE_INIT;
+
+static void build_lht(void)
+{
+	const char* table = &LHT[0][0][0][0];
+	
+	for(int r=0; r<LHT_ROWS; r++)
+	{
+		const char* row = table + r*LHT_ROW;
+		
+		for(int b=0; b<LHT_BLOCKS; b++)
+		{
+			int lo = b << LHT_BLOCK_BITS;
+			int hi = lo + (1 << LHT_BLOCK_BITS) < LHT_ROW ? lo + (1 << LHT_BLOCK_BITS) : LHT_ROW;
+			int min = row[lo];
+			
+			for(int x=lo; x<hi; x++)
+				if(row[x] < min)
+					min = row[x];
+			
+			lht.base[r][b] = min;
+			
+			for(int x=lo; x<hi; x++)
+			{
+				int offset = row[x] - min < LHT_ESCAPE ? row[x] - min : LHT_ESCAPE;
+				int bit = x*LHT_OFFSET_BITS;
+				
+				// an offset may straddle two bytes
+				lht.offsets[r][bit/8] |= offset << (bit%8);
+				if(bit%8 + LHT_OFFSET_BITS > 8)
+					lht.offsets[r][bit/8 + 1] |= offset >> (8 - bit%8);
+			}
+		}
+	}
+}
+
+// value of LHT at position x of row r
+static inline int lht_value(int r, int x)
+{
+	int bit = x*LHT_OFFSET_BITS;
+	const unsigned char* bytes = &lht.offsets[r][bit/8];
+	int offset = ((bytes[0] | bytes[1] << 8) >> (bit%8)) & LHT_ESCAPE;
+	
+	if(offset == LHT_ESCAPE)
+		return (&LHT[0][0][0][0])[r*LHT_ROW + x];
+	
+	return lht.base[r][x >> LHT_BLOCK_BITS] + offset;
+}
+
+// sums the values of the M rows starting at r for the positions x
+static int lht_sum(int r, const int* x)
+{
+	int sum = 0;
+	
+	for(int k=0; k<M; k++)
+		sum += lht_value(r+k, x[k]);
+	
+	return sum;
+}
+
+#ifdef HAVE_AVX2_DISPATCH
+// gathers 8 rows at a time; falls back to lht_sum if any of the values is an escape
+__attribute__((target("avx2")))
+static int lht_sum_avx2(int r, const int* x)
+{
+	const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	const __m256i escape_offset = _mm256_set1_epi32(LHT_ESCAPE);
+	const __m256i byte = _mm256_set1_epi32(0xFF);
+	const __m256i seven = _mm256_set1_epi32(7);
+	__m256i sum = _mm256_setzero_si256();
+	__m256i escape = _mm256_setzero_si256();
+	
+	for(int k=0; k<M; k+=8)
+	{
+		__m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(M-k), lane);
+		__m256i xv = _mm256_maskload_epi32(x+k, valid);
+		__m256i row = _mm256_add_epi32(_mm256_set1_epi32(r+k), lane);
+		
+		__m256i bit = _mm256_mullo_epi32(xv, _mm256_set1_epi32(LHT_OFFSET_BITS));
+		__m256i offset_idx = _mm256_add_epi32(_mm256_mullo_epi32(row, _mm256_set1_epi32(sizeof(lht.offsets[0]))), _mm256_srli_epi32(bit, 3));
+		__m256i base_idx = _mm256_add_epi32(_mm256_mullo_epi32(row, _mm256_set1_epi32(sizeof(lht.base[0]))), _mm256_srli_epi32(xv, LHT_BLOCK_BITS));
+		
+		__m256i offsets = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int*)lht.offsets, offset_idx, valid, 1);
+		__m256i base = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int*)lht.base, base_idx, valid, 1);
+		
+		__m256i offset = _mm256_and_si256(_mm256_srlv_epi32(offsets, _mm256_and_si256(bit, seven)), escape_offset);
+		
+		escape = _mm256_or_si256(escape, _mm256_and_si256(_mm256_cmpeq_epi32(offset, escape_offset), valid));
+		sum = _mm256_add_epi32(sum, _mm256_and_si256(_mm256_add_epi32(offset, _mm256_and_si256(base, byte)), valid));
+	}
+	
+	if(!_mm256_testz_si256(escape, escape))
+		return lht_sum(r, x);
+	
+	__m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+	
+	return _mm_cvtsi128_si32(s);
+}
+#endif
+
+static int avx2_available(void)
+{
+#ifdef HAVE_AVX2_DISPATCH
+	return __builtin_cpu_supports("avx2");
+#else
+	return 0;
+#endif
+}
+
+static int current_impl(void)
+{
+	if(lht_impl != LHT_AUTO)
+		return lht_impl;
+	
+	return avx2_available() ? LHT_AVX2 : LHT_PORTABLE;
+}
+
+// computes the guessing complexity of an entry of B22, whose coefficients must satisfy |c| < B22_BOUND
+int guessing_complexity(int i, int j, __int128* poly)
+{
+	pthread_once(&lht_once, build_lht);
+	
+	int r = (i*S + j)*M;
+	int x[M];
+	
+	for(int k=0; k<M; k++)
+		x[k] = poly[k] + B22_BOUND - 1;
+	
+#ifdef HAVE_AVX2_DISPATCH
+	if(current_impl() == LHT_AVX2)
+		return lht_sum_avx2(r, x);
+#endif
+	
+	return lht_sum(r, x);
+}
+
+int lht_select(const char* name)
+{
+	if(strcmp(name, "auto") == 0)
+		lht_impl = LHT_AUTO;
+	else if(strcmp(name, "portable") == 0)
+		lht_impl = LHT_PORTABLE;
+	else if(strcmp(name, "avx2") == 0 && avx2_available())
+		lht_impl = LHT_AVX2;
+	else
+		return -1;
+	
+	return 0;
+}
+
+const char* lht_selected(void)
+{
+	return current_impl() == LHT_AVX2 ? "avx2" : "portable";
+}
@@ -0,0 +1,10 @@
+#ifndef lht_functions_h
+#define lht_functions_h
+
+int guessing_complexity(int i, int j, __int128* poly);
+
+// Selects the table lookup by name ("auto", "portable" or "avx2"); returns -1 if it is unavailable
+int lht_select(const char* name);
+const char* lht_selected(void);
+
+#endif
@@ -0,0 +1,155 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "parameters.h"
+#include "rng.h"
+#include "rng_functions.h"
+#include "common_functions.h"
+#include "parallel_functions.h"
+#include "defiv2_keygen.h"
+
+// Estimates the base2 likelihood table of B22 (LHT) for the parameters in parameters.h and writes it as lht_table.h.
+// Usage: lht_generator [samples] [threads] > lht_table.h
+
+#define LHT_ROW (B22_BOUND * 2 - 1)
+
+// samples drawn per chunk; chunk c is seeded from the seed expander with diversifier c,
+// so the table depends on the number of samples only, not on the number of threads
+#define LHT_CHUNK 4096
+
+// 32 byte seed of the seed expander; changing it gives an independent estimate
+static unsigned char lht_seed[32] = "DEFIv2 likelihood table sampler";
+
+typedef uint64_t lht_counts[S][S][M][LHT_ROW];
+
+typedef struct {
+	int chunks;
+	lht_counts* counts;      // one histogram per worker
+	uint64_t* attempts;      // attempts at B22 per worker, including those violating a bound
+	int done;                // chunks finished, for progress
+} lht_job;
+
+// counts the coefficients of LHT_CHUNK matrices B22 which, with their B22^-1, satisfy the bounds
+static void lht_chunk(void* arg, int worker, int idx)
+{
+	lht_job* job = arg;
+	AES_XOF_struct xof;
+	unsigned char diversifier[8];
+	unsigned char seed[48];
+	
+	for(int i=0; i<8; i++)
+		diversifier[i] = (unsigned long long)idx >> (56 - 8*i);
+	
+	seedexpander_init(&xof, lht_seed, diversifier, 64);
+	seedexpander(&xof, seed, 48);
+	
+	rng_ctx rng;
+	initialize_rng_r(&rng, seed, 48);
+	
+	B22_draws d;
+	__int128*** B22 = allocate_ring_matrix(S, S);
+	__int128*** B22inv = allocate_ring_matrix(S, S);
+	
+	for(int n=0; n<LHT_CHUNK; )
+	{
+		draw_B22(&rng, &d);
+		job->attempts[worker]++;
+		
+		if(generate_B22(&d, B22)==false || generate_B22inv(&d, B22inv)==false)
+			continue;
+		
+		for(int i=0; i<S; i++)
+			for(int j=0; j<S; j++)
+				for(int k=0; k<M; k++)
+					job->counts[worker][i][j][k][B22[i][j][k] + B22_BOUND - 1]++;
+		n++;
+	}
+	
+	clear_rng_r(&rng);
+	free_ring_matrix(S, S, B22); B22 = NULL;
+	free_ring_matrix(S, S, B22inv); B22inv = NULL;
+	
+	int done = __atomic_add_fetch(&job->done, 1, __ATOMIC_RELAXED);
+	if(done % 64 == 0 || done == job->chunks)
+		fprintf(stderr, "\r%d/%d chunks", done, job->chunks);
+}
+
+int main(int argc, char** argv)
+{
+	double samples = argc > 1 ? atof(argv[1]) : 33554432;
+	int threads = argc > 2 ? atoi(argv[2]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+	
+	if(threads < 1)
+		threads = 1;
+	
+	lht_job job;
+	job.chunks = (int)ceil(samples / LHT_CHUNK);
+	job.counts = allocate_memory(threads*sizeof(lht_counts));
+	job.attempts = allocate_memory(threads*sizeof(uint64_t));
+	job.done = 0;
+	memset(job.counts, 0, threads*sizeof(lht_counts));
+	memset(job.attempts, 0, threads*sizeof(uint64_t));
+	
+	fprintf(stderr, "sampling %d chunks of %d on %d threads\n", job.chunks, LHT_CHUNK, threads);
+	parallel_for(threads, job.chunks, lht_chunk, &job);
+	fprintf(stderr, "\n");
+	
+	uint64_t attempts = 0;
+	for(int t=0; t<threads; t++)
+		attempts += job.attempts[t];
+	
+	// -log2 of the relative frequency, rounded down as in the shipped table; values never sampled get the weight of a single sample
+	double total = (double)job.chunks * LHT_CHUNK;
+	int cap = (int)floor(log2(total));
+	
+	printf("#ifndef lht_table_h\n#define lht_table_h\n\n");
+	printf("// included by lht_functions.c only; regenerate for other parameters with lht_generator (make lht_table)\n");
+	printf("#if S != %d || M != %d || B22_BOUND != %d\n", S, M, B22_BOUND);
+	printf("#error \"lht_table.h does not match parameters.h, regenerate it with make lht_table\"\n#endif\n\n");
+	printf("// base2 likehoolihood of values [-B22_BOUND+1, B22_BOUND-1] in the positions of matrix B22\n");
+	printf("// estimated by lht_generator from %.0f samples (%llu attempts)\n", total, (unsigned long long)attempts);
+	printf("static const char LHT[S][S][M][B22_BOUND * 2 - 1] =\n{\n");
+	
+	for(int i=0; i<S; i++)
+	{
+		printf("    {\n");
+		
+		for(int j=0; j<S; j++)
+		{
+			printf("        {\n");
+			
+			for(int k=0; k<M; k++)
+			{
+				printf("            {");
+				
+				for(int v=0; v<LHT_ROW; v++)
+				{
+					uint64_t count = 0;
+					for(int t=0; t<threads; t++)
+						count += job.counts[t][i][j][k][v];
+					
+					int value = count ? (int)floor(log2(total / count)) : cap;
+					printf(v ? ", %d" : "%d", value < cap ? value : cap);
+				}
+				
+				printf("},\n");
+			}
+			
+			printf("        },\n");
+		}
+		
+		printf("    },\n");
+	}
+	
+	printf("};\n\n#endif\n");
+	
+	free(job.counts);
+	free(job.attempts);
+	
+	return 0;
+}
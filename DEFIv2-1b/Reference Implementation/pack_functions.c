@@ -0,0 +1,297 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "parameters.h"
+#include "pack_functions.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define HAVE_BMI2_DISPATCH
+#endif
+
+enum { PACK_AUTO, PACK_PORTABLE, PACK_BMI2 };
+
+static int pack_impl = PACK_AUTO;
+
+// layout of C in the public key: C1, the C2 row and the upper triangle of C3
+const pack_block PK_LAYOUT[3] = {{1, C1_BITS, C1_BOUND}, {N-1, C2_BITS, C2_BOUND}, {N*(N-1)/2, C3_BITS, C3_BOUND}};
+
+// layout of B22^-1 in the secret key (after the 48 byte seed)
+const pack_block SK_LAYOUT[1] = {{S*S, B22inv_BITS, B22inv_BOUND}};
+
+// layout of y in the signature
+const pack_block SIG_LAYOUT[1] = {{S, Y_BITS, Y_BOUND}};
+
+// streams bits least significant first, moving whole 64-bit words to and from memory
+typedef struct {
+	unsigned char* out;
+	uint64_t acc;
+	int acc_bits;
+} bit_writer;
+
+typedef struct {
+	const unsigned char* in;
+	int bytes; // bytes left in the input
+	uint64_t acc;
+	int acc_bits;
+} bit_reader;
+
+static inline uint64_t load_le(const unsigned char* in, int bytes)
+{
+	uint64_t w = 0;
+
+	for(int i=0; i<bytes; i++)
+		w |= (uint64_t)in[i] << (8*i);
+
+	return w;
+}
+
+static inline void store_le(unsigned char* out, uint64_t w, int bytes)
+{
+	for(int i=0; i<bytes; i++)
+		out[i] = w >> (8*i);
+}
+
+// appends the low bits (at most 63) of v to the stream
+static inline void write_bits(bit_writer* w, uint64_t v, int bits)
+{
+	w->acc |= v << w->acc_bits;
+
+	if(w->acc_bits + bits >= 64)
+	{
+		store_le(w->out, w->acc, 8);
+		w->out += 8;
+		w->acc = v >> (64 - w->acc_bits); // acc_bits > 0 here since bits < 64
+		w->acc_bits += bits - 64;
+	}
+	else
+	{
+		w->acc_bits += bits;
+	}
+}
+
+// writes the remaining bits, zero padded to a whole byte
+static inline void flush_bits(bit_writer* w)
+{
+	store_le(w->out, w->acc, (w->acc_bits + 7) / 8);
+	w->out += (w->acc_bits + 7) / 8;
+	w->acc = 0;
+	w->acc_bits = 0;
+}
+
+// takes the next bits (at most 63) from the stream
+static inline uint64_t read_bits(bit_reader* r, int bits)
+{
+	uint64_t mask = (1ULL << bits) - 1;
+	uint64_t v;
+
+	if(r->acc_bits >= bits)
+	{
+		v = r->acc & mask;
+		r->acc >>= bits;
+		r->acc_bits -= bits;
+		return v;
+	}
+
+	int n = r->bytes < 8 ? r->bytes : 8;
+	uint64_t w = load_le(r->in, n);
+	r->in += n;
+	r->bytes -= n;
+
+	int used = bits - r->acc_bits;
+	v = (r->acc | (w << r->acc_bits)) & mask;
+	r->acc = w >> used;
+	r->acc_bits = 8*n - used;
+
+	return v;
+}
+
+static int bmi2_available(void)
+{
+#ifdef HAVE_BMI2_DISPATCH
+	return __builtin_cpu_supports("bmi2");
+#else
+	return 0;
+#endif
+}
+
+// auto is the portable packer: moving a few coefficients per pdep/pext measured slower than the shifts and masks of
+// write_bits and read_bits, and pdep/pext are microcoded on AMD before Zen 3; bmi2 stays available by name
+static int current_impl(void)
+{
+	if(pack_impl != PACK_AUTO)
+		return pack_impl;
+
+	return PACK_PORTABLE;
+}
+
+#ifdef HAVE_BMI2_DISPATCH
+// number of coefficients moved by a single pdep/pext, each in an 8 or 16 bit lane
+static int bmi2_lanes(int bits, int* lane_bits)
+{
+	*lane_bits = bits <= 8 ? 8 : 16;
+
+	if(bits > 16)
+		return 0;
+
+	int lanes = 64 / *lane_bits;
+
+	return lanes < 63/bits ? lanes : 63/bits;
+}
+
+static uint64_t bmi2_mask(int bits, int lane_bits, int lanes)
+{
+	uint64_t mask = 0;
+
+	for(int l=0; l<lanes; l++)
+		mask |= ((1ULL << bits) - 1) << (l*lane_bits);
+
+	return mask;
+}
+
+__attribute__((target("bmi2")))
+static void pack_poly_bmi2(bit_writer* w, const __int128* poly, int bits, int64_t bound)
+{
+	int lane_bits;
+	int lanes = bmi2_lanes(bits, &lane_bits);
+	uint64_t mask = bmi2_mask(bits, lane_bits, lanes);
+	int k = 0;
+
+	for(; k+lanes<=M; k+=lanes)
+	{
+		uint64_t x = 0;
+
+		for(int l=0; l<lanes; l++)
+			x |= ((uint64_t)(poly[k+l] + bound) & ((1ULL << bits) - 1)) << (l*lane_bits);
+
+		write_bits(w, _pext_u64(x, mask), lanes*bits);
+	}
+
+	for(; k<M; k++)
+		write_bits(w, (uint64_t)(poly[k] + bound) & ((1ULL << bits) - 1), bits);
+}
+
+__attribute__((target("bmi2")))
+static bool unpack_poly_bmi2(bit_reader* r, __int128* poly, int bits, int64_t bound)
+{
+	int lane_bits;
+	int lanes = bmi2_lanes(bits, &lane_bits);
+	uint64_t mask = bmi2_mask(bits, lane_bits, lanes);
+	uint64_t lane_mask = (1ULL << lane_bits) - 1;
+	bool in_bound = true;
+	int k = 0;
+
+	for(; k+lanes<=M; k+=lanes)
+	{
+		uint64_t x = _pdep_u64(read_bits(r, lanes*bits), mask);
+
+		for(int l=0; l<lanes; l++)
+		{
+			uint64_t v = (x >> (l*lane_bits)) & lane_mask;
+			in_bound &= v != 0;
+			poly[k+l] = (__int128)v - bound;
+		}
+	}
+
+	for(; k<M; k++)
+	{
+		uint64_t v = read_bits(r, bits);
+		in_bound &= v != 0;
+		poly[k] = (__int128)v - bound;
+	}
+
+	return in_bound;
+}
+#endif
+
+static void pack_poly(bit_writer* w, const __int128* poly, int bits, int64_t bound)
+{
+#ifdef HAVE_BMI2_DISPATCH
+	if(bits <= 16 && current_impl() == PACK_BMI2)
+	{
+		pack_poly_bmi2(w, poly, bits, bound);
+		return;
+	}
+#endif
+
+	for(int k=0; k<M; k++)
+		write_bits(w, (uint64_t)(poly[k] + bound) & ((1ULL << bits) - 1), bits);
+}
+
+// a coefficient is within its bound unless it unpacks to -bound, i.e. its packed value is zero
+static bool unpack_poly(bit_reader* r, __int128* poly, int bits, int64_t bound)
+{
+#ifdef HAVE_BMI2_DISPATCH
+	if(bits <= 16 && current_impl() == PACK_BMI2)
+		return unpack_poly_bmi2(r, poly, bits, bound);
+#endif
+
+	bool in_bound = true;
+
+	for(int k=0; k<M; k++)
+	{
+		uint64_t v = read_bits(r, bits);
+		in_bound &= v != 0;
+		poly[k] = (__int128)v - bound;
+	}
+
+	return in_bound;
+}
+
+// number of bytes occupied by a packed layout
+int packed_bytes(const pack_block* layout, int blocks)
+{
+	int total_bits = 0;
+
+	for(int b=0; b<blocks; b++)
+		total_bits += layout[b].polys * layout[b].bits * M;
+
+	return (total_bits + 7) / 8;
+}
+
+// packs the polynomials, in order, according to the layout; unused bits of the last byte are zero
+void pack_ring_polys(__int128** polys, const pack_block* layout, int blocks, unsigned char* out)
+{
+	bit_writer w = {out, 0, 0};
+	int p = 0;
+
+	for(int b=0; b<blocks; b++)
+		for(int i=0; i<layout[b].polys; i++)
+			pack_poly(&w, polys[p++], layout[b].bits, layout[b].bound);
+
+	flush_bits(&w);
+}
+
+// unpacks the polynomials, in order, according to the layout
+// returns true if all coefficients satisfy |c| < bound of their block
+bool unpack_ring_polys(const unsigned char* in, const pack_block* layout, int blocks, __int128** polys)
+{
+	bit_reader r = {in, packed_bytes(layout, blocks), 0, 0};
+	bool in_bound = true;
+	int p = 0;
+
+	for(int b=0; b<blocks; b++)
+		for(int i=0; i<layout[b].polys; i++)
+			in_bound &= unpack_poly(&r, polys[p++], layout[b].bits, layout[b].bound);
+
+	return in_bound;
+}
+
+int pack_select(const char* name)
+{
+	if(strcmp(name, "auto") == 0)
+		pack_impl = PACK_AUTO;
+	else if(strcmp(name, "portable") == 0)
+		pack_impl = PACK_PORTABLE;
+	else if(strcmp(name, "bmi2") == 0 && bmi2_available())
+		pack_impl = PACK_BMI2;
+	else
+		return -1;
+
+	return 0;
+}
+
+const char* pack_selected(void)
+{
+	return current_impl() == PACK_BMI2 ? "bmi2" : "portable";
+}
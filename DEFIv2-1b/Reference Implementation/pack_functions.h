@@ -0,0 +1,27 @@
+#ifndef pack_functions_h
+#define pack_functions_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// describes a run of ring polynomials whose coefficients are packed with the same width and offset
+typedef struct {
+	int polys;     // number of consecutive polynomials in the run
+	int bits;      // packed width of each coefficient
+	int64_t bound; // offset added to each coefficient before packing
+} pack_block;
+
+extern const pack_block PK_LAYOUT[3];
+extern const pack_block SK_LAYOUT[1];
+extern const pack_block SIG_LAYOUT[1];
+
+int packed_bytes(const pack_block* layout, int blocks);
+void pack_ring_polys(__int128** polys, const pack_block* layout, int blocks, unsigned char* out);
+bool unpack_ring_polys(const unsigned char* in, const pack_block* layout, int blocks, __int128** polys);
+
+// Selects the coefficient packer by name ("auto", "portable" or "bmi2"); returns -1 if it is unavailable
+// "auto" is the portable packer, which measured at least as fast as bmi2
+int pack_select(const char* name);
+const char* pack_selected(void);
+
+#endif
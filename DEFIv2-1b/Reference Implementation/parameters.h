@@ -29,4 +29,11 @@
 #define B22inv_BITS 12 // Computed: $log_2(2*\gamma_{B_{22}^{-1}})$
 #define Y_BITS 50 // Computed: $log_2(2*\gamma_{y})$
 
+// Signing attempts (measured, not from the paper)
+// A signing candidate is rejected when y violates Y_BOUND, which over 400000 signatures happened to 388 of 400388 candidates,
+// independently of each other; a signature thus needs more than k attempts with probability about 0.00097^k.
+// Attempts that suffice for a share of signatures, taking the rate at the top of its 95% confidence interval (0.0011):
+//   share of signatures   99%   99.9%   99.999%   1 - 10^-9   1 - 10^-12
+//   attempts              1     2       2         4           5
+
 #endif
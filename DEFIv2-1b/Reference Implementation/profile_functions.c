@@ -0,0 +1,67 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+#include <time.h>
+#include "profile_functions.h"
+
+static const char* profile_names[PROFILE_PHASES] = {"drbg", "b21", "b22", "c", "unpack", "hash", "a", "vt", "y", "zcz", "bounds", "pack"};
+
+// totals over all threads, updated with relaxed atomics
+static profile_data profile_totals;
+
+static struct {
+	profile_callback callback;
+	void* arg;
+} profile_listener;
+
+#if defined(DEFIV2_PROFILE) && !defined(__x86_64__) && !defined(__i386__)
+// nanoseconds stand in for cycles where there is no time stamp counter
+unsigned long long profile_cycles(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#endif
+
+const char* profile_phase_name(profile_phase phase)
+{
+	return phase < PROFILE_PHASES ? profile_names[phase] : "unknown";
+}
+
+void profile_snapshot(profile_data* data)
+{
+	for(int p=0; p<PROFILE_PHASES; p++)
+	{
+		data->cycles[p] = __atomic_load_n(&profile_totals.cycles[p], __ATOMIC_RELAXED);
+		data->calls[p] = __atomic_load_n(&profile_totals.calls[p], __ATOMIC_RELAXED);
+	}
+}
+
+void profile_reset(void)
+{
+	for(int p=0; p<PROFILE_PHASES; p++)
+	{
+		__atomic_store_n(&profile_totals.cycles[p], 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&profile_totals.calls[p], 0, __ATOMIC_RELAXED);
+	}
+}
+
+// the callback is invoked at the end of every phase, on the thread that ran it; set it while no operation is running
+void profile_set_callback(profile_callback callback, void* arg)
+{
+	profile_listener.arg = arg;
+	__atomic_store_n(&profile_listener.callback, callback, __ATOMIC_RELEASE);
+}
+
+void profile_add(profile_phase phase, unsigned long long cycles)
+{
+	__atomic_fetch_add(&profile_totals.cycles[phase], cycles, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&profile_totals.calls[phase], 1, __ATOMIC_RELAXED);
+	
+	profile_callback callback = __atomic_load_n(&profile_listener.callback, __ATOMIC_ACQUIRE);
+	
+	if(callback)
+		callback(phase, cycles, profile_listener.arg);
+}
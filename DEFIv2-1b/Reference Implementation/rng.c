@@ -8,11 +8,13 @@ You are solely responsible for determining the appropriateness of using and dist
 
 #include <string.h>
 #include "rng.h"
-#include <openssl/conf.h>
-#include <openssl/evp.h>
-#include <openssl/err.h>
+#include "aes.h"
+#include "profile_functions.h"
+#include <pthread.h>
 
+// The global DRBG behind randombytes() is shared by all threads and guarded by DRBG_lock
 AES256_CTR_DRBG_struct  DRBG_ctx;
+pthread_mutex_t         DRBG_lock = PTHREAD_MUTEX_INITIALIZER;
 
 void    AES256_ECB(unsigned char *key, unsigned char *ctr, unsigned char *buffer);
 
@@ -35,6 +37,7 @@ seedexpander_init(AES_XOF_struct *ctx,
     ctx->length_remaining = maxlen;
     
     memcpy(ctx->key, seed, 32);
+    aes256_key_expand(&ctx->ks, ctx->key);
     
     memcpy(ctx->ctr, diversifier, 8);
     ctx->ctr[11] = maxlen % 256;
@@ -84,7 +87,7 @@ seedexpander(AES_XOF_struct *ctx, unsigned char *x, unsigned long xlen)
         xlen -= 16-ctx->buffer_pos;
         offset += 16-ctx->buffer_pos;
         
-        AES256_ECB(ctx->key, ctx->ctr, ctx->buffer);
+        aes256_encrypt_block(&ctx->ks, ctx->ctr, ctx->buffer);
         ctx->buffer_pos = 0;
         int i;
         //increment the counter
@@ -103,43 +106,62 @@ seedexpander(AES_XOF_struct *ctx, unsigned char *x, unsigned long xlen)
 }
 
 
-void handleErrors(void)
-{
-    ERR_print_errors_fp(stderr);
-    abort();
-}
-
-// Use whatever AES implementation you have. This uses AES from openSSL library
+// Uses the in-tree AES implementation (aes.c), which picks AES-NI when the CPU supports it
 //    key - 256-bit AES key
 //    ctr - a 128-bit plaintext value
 //    buffer - a 128-bit ciphertext value
 void
 AES256_ECB(unsigned char *key, unsigned char *ctr, unsigned char *buffer)
 {
-    EVP_CIPHER_CTX *ctx;
-    
-    int len;
-    
-    int ciphertext_len;
-    
-    /* Create and initialise the context */
-    if(!(ctx = EVP_CIPHER_CTX_new())) handleErrors();
-    
-    if(1 != EVP_EncryptInit_ex(ctx, EVP_aes_256_ecb(), NULL, key, NULL))
-        handleErrors();
+    aes256_key  ks;
     
-    if(1 != EVP_EncryptUpdate(ctx, buffer, &len, ctr, 16))
-        handleErrors();
-    ciphertext_len = len;
+    aes256_key_expand(&ks, key);
+    aes256_encrypt_block(&ks, ctr, buffer);
+}
+
+// CTR_DRBG update on a DRBG state, reusing and then refreshing its expanded key
+static void
+drbg_update(AES256_CTR_DRBG_struct *ctx, unsigned char *provided_data)
+{
+    unsigned char   temp[48];
+    int i;
     
-    /* Clean up */
-    EVP_CIPHER_CTX_free(ctx);
+    aes256_ctr_blocks(&ctx->ks, ctx->V, temp, 3);
+    if ( provided_data != NULL )
+        for (i=0; i<48; i++)
+            temp[i] ^= provided_data[i];
+    memcpy(ctx->Key, temp, 32);
+    memcpy(ctx->V, temp+32, 16);
+    aes256_key_expand(&ctx->ks, ctx->Key);
 }
 
 void
 randombytes_init(unsigned char *entropy_input,
                  unsigned char *personalization_string,
                  int security_strength)
+{
+    pthread_mutex_lock(&DRBG_lock);
+    randombytes_init_r(&DRBG_ctx, entropy_input, personalization_string, security_strength);
+    pthread_mutex_unlock(&DRBG_lock);
+}
+
+int
+randombytes(unsigned char *x, unsigned long long xlen)
+{
+    int ret;
+    
+    pthread_mutex_lock(&DRBG_lock);
+    ret = randombytes_r(&DRBG_ctx, x, xlen);
+    pthread_mutex_unlock(&DRBG_lock);
+    
+    return ret;
+}
+
+void
+randombytes_init_r(AES256_CTR_DRBG_struct *ctx,
+                   unsigned char *entropy_input,
+                   unsigned char *personalization_string,
+                   int security_strength)
 {
     unsigned char   seed_material[48];
     int i;
@@ -147,42 +169,29 @@ randombytes_init(unsigned char *entropy_input,
     if (personalization_string)
         for (i=0; i<48; i++)
             seed_material[i] ^= personalization_string[i];
-    memset(DRBG_ctx.Key, 0x00, 32);
-    memset(DRBG_ctx.V, 0x00, 16);
-    AES256_CTR_DRBG_Update(seed_material, DRBG_ctx.Key, DRBG_ctx.V);
-    DRBG_ctx.reseed_counter = 1;
+    memset(ctx->Key, 0x00, 32);
+    memset(ctx->V, 0x00, 16);
+    aes256_key_expand(&ctx->ks, ctx->Key);
+    drbg_update(ctx, seed_material);
+    ctx->reseed_counter = 1;
 }
 
 int
-randombytes(unsigned char *x, unsigned long long xlen)
+randombytes_r(AES256_CTR_DRBG_struct *ctx, unsigned char *x, unsigned long long xlen)
 {
     unsigned char   block[16];
-    int             i = 0;
-    int j;
-    while ( xlen > 0 ) {
-        //increment V
-        for (j=15; j>=0; j--) {
-            if ( DRBG_ctx.V[j] == 0xff )
-                DRBG_ctx.V[j] = 0x00;
-            else {
-                DRBG_ctx.V[j]++;
-                break;
-            }
-        }
-        AES256_ECB(DRBG_ctx.Key, DRBG_ctx.V, block);
-        if ( xlen > 15 ) {
-            memcpy(x+i, block, 16);
-            i += 16;
-            xlen -= 16;
-        }
-        else {
-            memcpy(x+i, block, xlen);
-            xlen = 0;
-        }
+    PROFILE_BEGIN(PROFILE_DRBG);
+    
+    // whole blocks are generated in one call, straight into x
+    aes256_ctr_blocks(&ctx->ks, ctx->V, x, xlen/16);
+    if ( xlen % 16 ) {
+        aes256_ctr_blocks(&ctx->ks, ctx->V, block, 1);
+        memcpy(x+xlen-xlen%16, block, xlen%16);
     }
-    AES256_CTR_DRBG_Update(NULL, DRBG_ctx.Key, DRBG_ctx.V);
-    DRBG_ctx.reseed_counter++;
+    drbg_update(ctx, NULL);
+    ctx->reseed_counter++;
     
+    PROFILE_END(PROFILE_DRBG);
     return RNG_SUCCESS;
 }
 
@@ -191,33 +200,12 @@ AES256_CTR_DRBG_Update(unsigned char *provided_data,
                        unsigned char *Key,
                        unsigned char *V)
 {
-    unsigned char   temp[48];
-    int i,j;
-    for (i=0; i<3; i++) {
-        //increment V
-        for (j=15; j>=0; j--) {
-            if ( V[j] == 0xff )
-                V[j] = 0x00;
-            else {
-                V[j]++;
-                break;
-            }
-        }
-        
-        AES256_ECB(Key, V, temp+16*i);
-    }
-    if ( provided_data != NULL )
-        for (i=0; i<48; i++)
-            temp[i] ^= provided_data[i];
-    memcpy(Key, temp, 32);
-    memcpy(V, temp+32, 16);
+    AES256_CTR_DRBG_struct  ctx;
+    
+    memcpy(ctx.Key, Key, 32);
+    memcpy(ctx.V, V, 16);
+    aes256_key_expand(&ctx.ks, ctx.Key);
+    drbg_update(&ctx, provided_data);
+    memcpy(Key, ctx.Key, 32);
+    memcpy(V, ctx.V, 16);
 }
-
-
-
-
-
-
-
-
-
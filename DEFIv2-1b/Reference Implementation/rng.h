@@ -10,6 +10,7 @@ You are solely responsible for determining the appropriateness of using and dist
 #define rng_h
 
 #include <stdio.h>
+#include "aes.h"
 
 #define RNG_SUCCESS      0
 #define RNG_BAD_MAXLEN  -1
@@ -22,12 +23,14 @@ typedef struct {
     unsigned long   length_remaining;
     unsigned char   key[32];
     unsigned char   ctr[16];
+    aes256_key      ks;         // expanded key
 } AES_XOF_struct;
 
 typedef struct {
     unsigned char   Key[32];
     unsigned char   V[16];
     int             reseed_counter;
+    aes256_key      ks;         // expansion of Key, refreshed whenever Key changes
 } AES256_CTR_DRBG_struct;
 
 
@@ -53,4 +56,14 @@ randombytes_init(unsigned char *entropy_input,
 int
 randombytes(unsigned char *x, unsigned long long xlen);
 
+// Re-entrant versions operating on a caller owned DRBG state
+void
+randombytes_init_r(AES256_CTR_DRBG_struct *ctx,
+                   unsigned char *entropy_input,
+                   unsigned char *personalization_string,
+                   int security_strength);
+
+int
+randombytes_r(AES256_CTR_DRBG_struct *ctx, unsigned char *x, unsigned long long xlen);
+
 #endif /* rng_h */
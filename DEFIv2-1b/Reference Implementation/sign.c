@@ -14,13 +14,74 @@ int crypto_sign_keypair(unsigned char *pk, unsigned char *sk)
 	return key_gen(pk, sk);
 }
 
+int crypto_sign_keypair_seeded(const unsigned char *seed, unsigned char *pk, unsigned char *sk)
+{
+	return key_gen_seeded(seed, pk, sk);
+}
+
+int crypto_sign_keypair_parallel(unsigned char *pk, unsigned char *sk, int threads)
+{
+	return key_gen_mt(pk, sk, threads);
+}
+
+int crypto_sign_keypair_batch(const unsigned char *master_seed, int count, unsigned char *pks, unsigned char *sks, int threads)
+{
+	return key_gen_batch(master_seed, count, pks, sks, threads);
+}
+
 int crypto_sign(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk)
 {
 	return sig_gen(sm, smlen, m, mlen, sk);
 }
 
+int crypto_sign_parallel(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk, int threads)
+{
+	return sig_gen_mt(sm, smlen, m, mlen, sk, threads);
+}
+
+int crypto_sign_bounded(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk,
+	int threads, unsigned long long max_attempts, unsigned long long max_ns, unsigned long long *attempts, unsigned long long *elapsed_ns)
+{
+	sig_budget budget = {max_attempts, max_ns};
+	sig_progress progress;
+	
+	int ret = sig_gen_bounded(sm, smlen, m, mlen, sk, threads, &budget, &progress);
+	
+	if(attempts != NULL)
+		*attempts = progress.attempts;
+	
+	if(elapsed_ns != NULL)
+		*elapsed_ns = progress.elapsed_ns;
+	
+	return ret;
+}
+
+int crypto_sign_batch(unsigned char **sms, unsigned long long *smlens, const unsigned char *const *ms, const unsigned long long *mlens,
+	int count, const unsigned char *sk, int threads)
+{
+	return sig_gen_batch(sms, smlens, ms, mlens, count, sk, threads);
+}
+
+int crypto_sign_cosign(unsigned char **sigs, unsigned long long *siglens, const unsigned char *m, unsigned long long mlen,
+	const unsigned char *const *sks, int count, int threads)
+{
+	return sig_gen_cosign(sigs, siglens, m, mlen, sks, count, threads);
+}
+
 int crypto_sign_open(unsigned char *m, unsigned long long *mlen, const unsigned char *sm, unsigned long long smlen, const unsigned char *pk)
 {
 	return sig_ver(m, mlen, sm, smlen, pk);
 }
 
+int crypto_sign_open_batch(unsigned char **ms, unsigned long long *mlens, const unsigned char *const *sms, const unsigned long long *smlens,
+	const unsigned char *const *pks, int count, unsigned char *results, int threads)
+{
+	return sig_ver_batch(ms, mlens, sms, smlens, pks, count, results, threads);
+}
+
+int crypto_sign_cosign_open(const unsigned char *m, unsigned long long mlen, const unsigned char *const *sigs, const unsigned long long *siglens,
+	const unsigned char *const *pks, int count, unsigned char *results, int threads)
+{
+	return sig_ver_cosign(m, mlen, sigs, siglens, pks, count, results, threads);
+}
+
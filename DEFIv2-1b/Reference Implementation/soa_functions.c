@@ -0,0 +1,170 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include "parameters.h"
+#include "common_functions.h"
+#include "soa_functions.h"
+
+__int128* allocate_soa_poly(int lanes)
+{
+	__int128* A = allocate_memory(M*lanes*sizeof(__int128));
+	zero_vector(M*lanes, A);
+	
+	return A;
+}
+
+__int128** allocate_soa_vector(int n, int lanes)
+{
+	__int128** A = allocate_memory(n*sizeof(__int128*));
+	
+	for(int i=0; i<n; i++)
+		A[i] = allocate_soa_poly(lanes);
+	
+	return A;
+}
+
+__int128*** allocate_soa_matrix(int m, int n, int lanes)
+{
+	__int128*** A = allocate_memory(m*sizeof(__int128**));
+	
+	for(int i=0; i<m; i++)
+		A[i] = allocate_soa_vector(n, lanes);
+	
+	return A;
+}
+
+void free_soa_vector(int n, __int128** A)
+{
+	free_ring_vector(n, A);
+}
+
+void free_soa_matrix(int m, int n, __int128*** A)
+{
+	free_ring_matrix(m, n, A);
+}
+
+void soa_gather(int lanes, int count, __int128** polys, __int128* soa)
+{
+	for(int k=0; k<M; k++)
+		for(int t=0; t<lanes; t++)
+			soa[k*lanes+t] = t < count ? polys[t][k] : 0;
+}
+
+void soa_scatter(int lanes, int count, const __int128* soa, __int128** polys)
+{
+	for(int k=0; k<M; k++)
+		for(int t=0; t<count; t++)
+			polys[t][k] = soa[k*lanes+t];
+}
+
+// performs polynomial multiplication modulo x^m+x+1 of each instance and stores it in result_poly
+void product_in_ring_soa(int lanes, const __int128* restrict poly1, const __int128* restrict poly2, __int128* restrict result_poly, bool overwrite)
+{
+	if(overwrite==true)
+		zero_vector(M*lanes, result_poly);
+	
+	for(int i=0; i<M; i++)
+	{
+		const __int128* a = poly1 + i*lanes;
+		
+		for(int j=0; j<M; j++)
+		{
+			const __int128* b = poly2 + j*lanes;
+			
+			if(i+j<M)
+			{
+				__int128* r = result_poly + (i+j)*lanes;
+				
+				for(int t=0; t<lanes; t++)
+					r[t] += a[t]*b[t];
+			}
+			else
+			{
+				// x^(i+j) = -x^(i+j-m) - x^(i+j-m+1)
+				__int128* r = result_poly + (i+j-M)*lanes;
+				
+				for(int t=0; t<lanes; t++)
+				{
+					__int128 val = a[t]*b[t];
+					r[t] -= val;
+					r[t+lanes] -= val;
+				}
+			}
+		}
+	}
+}
+
+void product_in_ring_shared(int lanes, const __int128* restrict poly1, const __int128* restrict poly2, __int128* restrict result_poly, bool overwrite)
+{
+	if(overwrite==true)
+		zero_vector(M*lanes, result_poly);
+	
+	for(int i=0; i<M; i++)
+	{
+		__int128 a = poly1[i];
+		
+		if(a==0)
+			continue;
+		
+		for(int j=0; j<M; j++)
+		{
+			const __int128* b = poly2 + j*lanes;
+			
+			if(i+j<M)
+			{
+				__int128* r = result_poly + (i+j)*lanes;
+				
+				for(int t=0; t<lanes; t++)
+					r[t] += a*b[t];
+			}
+			else
+			{
+				__int128* r = result_poly + (i+j-M)*lanes;
+				
+				for(int t=0; t<lanes; t++)
+				{
+					__int128 val = a*b[t];
+					r[t] -= val;
+					r[t+lanes] -= val;
+				}
+			}
+		}
+	}
+}
+
+void rmv_multiply_soa(int m, int l, int lanes, __int128*** A, __int128** b, __int128** c)
+{
+	for(int i=0; i<m; i++)
+	{
+		zero_vector(M*lanes, c[i]);
+		
+		for(int j=0; j<l; j++)
+			product_in_ring_shared(lanes, A[i][j], b[j], c[i], false);
+	}
+}
+
+void rmm_multiply_soa(int m, int l, int n, int lanes, __int128*** A, __int128*** B, __int128*** C)
+{
+	for(int i=0; i<m; i++)
+		for(int j=0; j<n; j++)
+		{
+			zero_vector(M*lanes, C[i][j]);
+			
+			for(int k=0; k<l; k++)
+				product_in_ring_soa(lanes, A[i][k], B[k][j], C[i][j], false);
+		}
+}
+
+void rdm_multiply_soa(int m, int n, int lanes, __int128** D, __int128*** A, __int128*** C)
+{
+	for(int i=0; i<m; i++)
+		for(int j=0; j<n; j++)
+			product_in_ring_soa(lanes, D[i], A[i][j], C[i][j], true);
+}
+
+void rvv_multiply_soa(int n, int lanes, __int128** a, __int128** b, __int128* c)
+{
+	zero_vector(M*lanes, c);
+	
+	for(int i=0; i<n; i++)
+		product_in_ring_soa(lanes, a[i], b[i], c, false);
+}
@@ -0,0 +1,184 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include "common_functions.h"
+#include "stats_functions.h"
+
+// defi_stats is summed and cleared as a plain array of counters
+#define STATS_COUNTERS (sizeof(defi_stats) / sizeof(unsigned long long))
+
+// counters of one thread; only the owner writes them, with relaxed atomics so queries from other threads are well defined
+typedef struct stats_block {
+	defi_stats stats;
+	struct stats_block* next;
+} stats_block;
+
+static bool stats_on = false;
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static stats_block* stats_blocks = NULL; // blocks of the live threads
+static defi_stats stats_retired;         // sum of the blocks of the threads that have exited
+
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t stats_key;
+
+static void add_counters(defi_stats* sum, defi_stats* stats)
+{
+	unsigned long long* s = (unsigned long long*)sum;
+	unsigned long long* c = (unsigned long long*)stats;
+	
+	for(size_t i=0; i<STATS_COUNTERS; i++)
+		s[i] += __atomic_load_n(&c[i], __ATOMIC_RELAXED);
+}
+
+// folds the block of an exiting thread into stats_retired
+static void retire_block(void* p)
+{
+	stats_block* block = p;
+	
+	pthread_mutex_lock(&stats_lock);
+	
+	add_counters(&stats_retired, &block->stats);
+	
+	for(stats_block** b = &stats_blocks; *b; b = &(*b)->next)
+		if(*b == block)
+		{
+			*b = block->next;
+			break;
+		}
+	
+	pthread_mutex_unlock(&stats_lock);
+	
+	free(block);
+}
+
+static void create_key(void)
+{
+	pthread_key_create(&stats_key, retire_block);
+}
+
+static defi_stats* thread_stats(void)
+{
+	pthread_once(&stats_once, create_key);
+	
+	stats_block* block = pthread_getspecific(stats_key);
+	
+	if(block == NULL)
+	{
+		block = allocate_memory(sizeof(stats_block));
+		memset(block, 0, sizeof(stats_block));
+		
+		pthread_mutex_lock(&stats_lock);
+		block->next = stats_blocks;
+		stats_blocks = block;
+		pthread_mutex_unlock(&stats_lock);
+		
+		pthread_setspecific(stats_key, block);
+	}
+	
+	return &block->stats;
+}
+
+static inline void count(unsigned long long* c, unsigned long long v)
+{
+	__atomic_store_n(c, *c + v, __ATOMIC_RELAXED);
+}
+
+void stats_enable(bool on)
+{
+	__atomic_store_n(&stats_on, on, __ATOMIC_RELAXED);
+}
+
+bool stats_enabled(void)
+{
+	return __atomic_load_n(&stats_on, __ATOMIC_RELAXED);
+}
+
+// sums the counters of all threads, including those that have exited
+void stats_snapshot(defi_stats* stats)
+{
+	memset(stats, 0, sizeof(defi_stats));
+	
+	pthread_mutex_lock(&stats_lock);
+	
+	add_counters(stats, &stats_retired);
+	
+	for(stats_block* b = stats_blocks; b; b = b->next)
+		add_counters(stats, &b->stats);
+	
+	pthread_mutex_unlock(&stats_lock);
+}
+
+// the counters of the calling thread alone
+void stats_thread_snapshot(defi_stats* stats)
+{
+	memset(stats, 0, sizeof(defi_stats));
+	add_counters(stats, thread_stats());
+}
+
+// clears all counters; operations running meanwhile may be partly counted
+void stats_reset(void)
+{
+	pthread_mutex_lock(&stats_lock);
+	
+	memset(&stats_retired, 0, sizeof(defi_stats));
+	
+	for(stats_block* b = stats_blocks; b; b = b->next)
+	{
+		unsigned long long* c = (unsigned long long*)&b->stats;
+		
+		for(size_t i=0; i<STATS_COUNTERS; i++)
+			__atomic_store_n(&c[i], 0, __ATOMIC_RELAXED);
+	}
+	
+	pthread_mutex_unlock(&stats_lock);
+}
+
+unsigned long long stats_now(void)
+{
+	if(!stats_enabled())
+		return 0;
+	
+	return stats_clock();
+}
+
+// the monotonic clock in nanoseconds, whether or not statistics are enabled
+unsigned long long stats_clock(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// counts a failed check of an attempt of op started at start (from stats_now)
+void stats_reject(reject_kind kind, stats_op op, unsigned long long start)
+{
+	if(start == 0 || !stats_enabled())
+		return;
+	
+	defi_stats* stats = thread_stats();
+	
+	count(&stats->rejects[kind], 1);
+	count(&stats->ops[op].rejected_ns, stats_now() - start);
+}
+
+// counts an operation started at start (from stats_now) that needed the given number of attempts
+void stats_operation(stats_op op, unsigned long long attempts, unsigned long long start)
+{
+	if(start == 0 || !stats_enabled())
+		return;
+	
+	op_stats* stats = &thread_stats()->ops[op];
+	int bin = attempts < STATS_HISTOGRAM_BINS ? attempts - 1 : STATS_HISTOGRAM_BINS - 1;
+	
+	count(&stats->operations, 1);
+	count(&stats->attempts, attempts);
+	count(&stats->histogram[bin], 1);
+	count(&stats->total_ns, stats_now() - start);
+}
@@ -0,0 +1,57 @@
+#ifndef stats_functions_h
+#define stats_functions_h
+
+#include <stdbool.h>
+
+// Opt-in statistics of the rejection loops of key generation and signing.
+// Counters are kept per thread and summed on query; nothing is recorded until stats_enable(true).
+
+// checks whose failures are counted
+typedef enum {
+	REJECT_B22,        // a coefficient of B22 violates B22_BOUND
+	REJECT_GUESSING,   // an entry of B22 has a guessing complexity below G
+	REJECT_B22INV,     // a coefficient of B22^-1 violates B22inv_BOUND
+	REJECT_C1,         // a coefficient of C1 violates C1_BOUND
+	REJECT_C2,         // a coefficient of C2 violates C2_BOUND
+	REJECT_C3,         // a coefficient of C3 violates C3_BOUND
+	REJECT_Y,          // a coefficient of y violates Y_BOUND
+	REJECT_KINDS
+} reject_kind;
+
+// rejection loops whose attempts are counted
+typedef enum {
+	STATS_KEYGEN,      // attempts at B (and C) per keypair
+	STATS_B22,         // attempts at B22 per B
+	STATS_SIGN,        // candidates per signature
+	STATS_OPS
+} stats_op;
+
+// histogram[a] counts the operations that needed a+1 attempts; the last bin also counts all longer ones
+#define STATS_HISTOGRAM_BINS 32
+
+typedef struct {
+	unsigned long long operations;
+	unsigned long long attempts;
+	unsigned long long histogram[STATS_HISTOGRAM_BINS];
+	unsigned long long total_ns;      // time spent in the operations
+	unsigned long long rejected_ns;   // time spent in attempts that were rejected
+} op_stats;
+
+typedef struct {
+	op_stats ops[STATS_OPS];
+	unsigned long long rejects[REJECT_KINDS];
+} defi_stats;
+
+void stats_enable(bool on);
+bool stats_enabled(void);
+void stats_snapshot(defi_stats* stats);
+void stats_thread_snapshot(defi_stats* stats);
+void stats_reset(void);
+
+// hooks of the rejection loops; stats_now() returns 0 while statistics are disabled
+unsigned long long stats_now(void);
+unsigned long long stats_clock(void);
+void stats_reject(reject_kind kind, stats_op op, unsigned long long start);
+void stats_operation(stats_op op, unsigned long long attempts, unsigned long long start);
+
+#endif
@@ -0,0 +1,171 @@
+#ifndef defiv2_h
+#define defiv2_h
+
+// Both parameter sets of DEFIv2 in one library.
+// The NIST API (api.h) of each variant is available under the prefix defiv2_1a_ or defiv2_1b_,
+// and through the defiv2_scheme of the variant when it is chosen at run time.
+// Key generation is the same in both variants, so a keypair can be used with either of them.
+
+#define DEFIV2_SECRETKEYBYTES 426
+#define DEFIV2_PUBLICKEYBYTES 515
+#define DEFIV2_BYTES 525
+
+#define DEFIV2_DECLARE_API(prefix) \
+	int prefix##crypto_sign_keypair(unsigned char *pk, unsigned char *sk); \
+	int prefix##crypto_sign_keypair_seeded(const unsigned char *seed, unsigned char *pk, unsigned char *sk); \
+	int prefix##crypto_sign_keypair_parallel(unsigned char *pk, unsigned char *sk, int threads); \
+	int prefix##crypto_sign_keypair_batch(const unsigned char *master_seed, int count, unsigned char *pks, unsigned char *sks, int threads); \
+	int prefix##crypto_sign(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk); \
+	int prefix##crypto_sign_parallel(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk, int threads); \
+	int prefix##crypto_sign_bounded(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk, \
+		int threads, unsigned long long max_attempts, unsigned long long max_ns, unsigned long long *attempts, unsigned long long *elapsed_ns); \
+	int prefix##crypto_sign_batch(unsigned char **sms, unsigned long long *smlens, const unsigned char *const *ms, const unsigned long long *mlens, \
+		int count, const unsigned char *sk, int threads); \
+	int prefix##crypto_sign_cosign(unsigned char **sigs, unsigned long long *siglens, const unsigned char *m, unsigned long long mlen, \
+		const unsigned char *const *sks, int count, int threads); \
+	int prefix##crypto_sign_open(unsigned char *m, unsigned long long *mlen, const unsigned char *sm, unsigned long long smlen, const unsigned char *pk); \
+	int prefix##crypto_sign_open_batch(unsigned char **ms, unsigned long long *mlens, const unsigned char *const *sms, const unsigned long long *smlens, \
+		const unsigned char *const *pks, int count, unsigned char *results, int threads); \
+	int prefix##crypto_sign_cosign_open(const unsigned char *m, unsigned long long mlen, const unsigned char *const *sigs, \
+		const unsigned long long *siglens, const unsigned char *const *pks, int count, unsigned char *results, int threads);
+
+DEFIV2_DECLARE_API(defiv2_1a_)
+DEFIV2_DECLARE_API(defiv2_1b_)
+
+typedef enum {
+	DEFIV2_1A,
+	DEFIV2_1B,
+	DEFIV2_VARIANTS
+} defiv2_variant;
+
+// the API of one variant, as function pointers
+typedef struct {
+	const char* name; // "DEFIv2-1a" or "DEFIv2-1b"
+	defiv2_variant variant;
+	int public_key_bytes;
+	int secret_key_bytes;
+	int signature_bytes;
+	int (*keypair)(unsigned char *pk, unsigned char *sk);
+	int (*keypair_seeded)(const unsigned char *seed, unsigned char *pk, unsigned char *sk);
+	int (*keypair_parallel)(unsigned char *pk, unsigned char *sk, int threads);
+	int (*keypair_batch)(const unsigned char *master_seed, int count, unsigned char *pks, unsigned char *sks, int threads);
+	int (*sign)(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk);
+	int (*sign_parallel)(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk, int threads);
+	int (*sign_bounded)(unsigned char *sm, unsigned long long *smlen, const unsigned char *m, unsigned long long mlen, const unsigned char *sk,
+		int threads, unsigned long long max_attempts, unsigned long long max_ns, unsigned long long *attempts, unsigned long long *elapsed_ns);
+	int (*sign_batch)(unsigned char **sms, unsigned long long *smlens, const unsigned char *const *ms, const unsigned long long *mlens,
+		int count, const unsigned char *sk, int threads);
+	int (*cosign)(unsigned char **sigs, unsigned long long *siglens, const unsigned char *m, unsigned long long mlen,
+		const unsigned char *const *sks, int count, int threads);
+	int (*open)(unsigned char *m, unsigned long long *mlen, const unsigned char *sm, unsigned long long smlen, const unsigned char *pk);
+	int (*open_batch)(unsigned char **ms, unsigned long long *mlens, const unsigned char *const *sms, const unsigned long long *smlens,
+		const unsigned char *const *pks, int count, unsigned char *results, int threads);
+	int (*cosign_open)(const unsigned char *m, unsigned long long mlen, const unsigned char *const *sigs, const unsigned long long *siglens,
+		const unsigned char *const *pks, int count, unsigned char *results, int threads);
+} defiv2_scheme;
+
+// returns NULL for an unknown variant
+const defiv2_scheme* defiv2_scheme_get(defiv2_variant variant);
+
+// looks a variant up by name, "DEFIv2-1a" or just "1a" (case insensitive); returns NULL if there is none
+const defiv2_scheme* defiv2_scheme_find(const char* name);
+
+// seeds the DRBG behind crypto_sign_keypair of both variants, as randombytes_init in rng.h
+void defiv2_randombytes_init(unsigned char *entropy_input, unsigned char *personalization_string, int security_strength);
+int defiv2_randombytes(unsigned char *x, unsigned long long xlen);
+
+// pool of keypairs generated ahead of time by background threads, as keypair_pool in keypool_functions.h
+// key generation is the same in both variants, so its keypairs can be used with either of them
+typedef struct defiv2_keypair_pool defiv2_keypair_pool;
+
+typedef struct {
+	unsigned long long hits;          // keypairs handed out from the pool
+	unsigned long long misses;        // keypairs generated on the calling thread because the pool was empty
+	unsigned long long refills;       // keypairs added to the pool by the background threads
+	unsigned long long lag_total_ns;  // sum over refills of the time the refilled slot was empty
+	unsigned long long lag_max_ns;    // longest time a slot was empty before it was refilled
+	int available;                    // keypairs currently in the pool
+} defiv2_keypair_pool_stats;
+
+defiv2_keypair_pool* defiv2_keypair_pool_create(int depth, int threads);
+int defiv2_keypair_pool_take(defiv2_keypair_pool* pool, unsigned char *pk, unsigned char *sk);
+void defiv2_keypair_pool_get_stats(defiv2_keypair_pool* pool, defiv2_keypair_pool_stats* stats);
+void defiv2_keypair_pool_destroy(defiv2_keypair_pool* pool);
+
+// statistics of the rejection loops of both variants, as stats_functions.h; nothing is recorded until defiv2_stats_enable(1)
+typedef enum {
+	DEFIV2_REJECT_B22,
+	DEFIV2_REJECT_GUESSING,
+	DEFIV2_REJECT_B22INV,
+	DEFIV2_REJECT_C1,
+	DEFIV2_REJECT_C2,
+	DEFIV2_REJECT_C3,
+	DEFIV2_REJECT_Y,
+	DEFIV2_REJECT_KINDS
+} defiv2_reject_kind;
+
+typedef enum {
+	DEFIV2_STATS_KEYGEN,  // attempts at B (and C) per keypair
+	DEFIV2_STATS_B22,     // attempts at B22 per B
+	DEFIV2_STATS_SIGN,    // candidates per signature
+	DEFIV2_STATS_OPS
+} defiv2_stats_op;
+
+// histogram[a] counts the operations that needed a+1 attempts; the last bin also counts all longer ones
+#define DEFIV2_STATS_HISTOGRAM_BINS 32
+
+typedef struct {
+	unsigned long long operations;
+	unsigned long long attempts;
+	unsigned long long histogram[DEFIV2_STATS_HISTOGRAM_BINS];
+	unsigned long long total_ns;     // time spent in the operations
+	unsigned long long rejected_ns;  // time spent in attempts that were rejected
+} defiv2_op_stats;
+
+typedef struct {
+	defiv2_op_stats ops[DEFIV2_STATS_OPS];
+	unsigned long long rejects[DEFIV2_REJECT_KINDS];
+} defiv2_stats;
+
+void defiv2_stats_enable(int on);
+int defiv2_stats_enabled(void);
+void defiv2_stats_snapshot(defiv2_stats* stats);
+void defiv2_stats_reset(void);
+
+// per-phase cycle counts, as profile_functions.h; they stay zero unless the library is built with make PROFILE=1
+typedef enum {
+	DEFIV2_PROFILE_DRBG,
+	DEFIV2_PROFILE_B21,
+	DEFIV2_PROFILE_B22,
+	DEFIV2_PROFILE_C,
+	DEFIV2_PROFILE_UNPACK,
+	DEFIV2_PROFILE_HASH,
+	DEFIV2_PROFILE_A,
+	DEFIV2_PROFILE_VT,
+	DEFIV2_PROFILE_Y,
+	DEFIV2_PROFILE_ZCZ,
+	DEFIV2_PROFILE_BOUNDS,
+	DEFIV2_PROFILE_PACK,
+	DEFIV2_PROFILE_PHASES
+} defiv2_profile_phase;
+
+typedef struct {
+	unsigned long long cycles[DEFIV2_PROFILE_PHASES];
+	unsigned long long calls[DEFIV2_PROFILE_PHASES];
+} defiv2_profile_data;
+
+typedef void (*defiv2_profile_callback)(defiv2_profile_phase phase, unsigned long long cycles, void* arg);
+
+const char* defiv2_profile_phase_name(defiv2_profile_phase phase);
+void defiv2_profile_snapshot(defiv2_profile_data* data);
+void defiv2_profile_reset(void);
+// the callback is invoked at the end of every phase, on the thread that ran it; set it while no operation is running
+void defiv2_profile_set_callback(defiv2_profile_callback callback, void* arg);
+
+// selects the implementation of a kernel of both variants, given as aes=<name>, pack=<name>, lht=<name> or shake=<name>
+// as in aes256_select etc.; returns -1 if the kernel or the implementation is unknown or unavailable
+int defiv2_select(const char* choice);
+// returns the implementation in use of the kernel "aes", "pack", "lht" or "shake", or NULL for an unknown kernel
+const char* defiv2_selected(const char* kernel);
+
+#endif
@@ -0,0 +1,297 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "defiv2.h"
+
+// Checks the unified library against the KAT files of the variant trees: every vector of each file is
+// regenerated through the defiv2_scheme of its variant, and its signed message opened again.
+// Usage: defiv2_check <variant> <file.rsp> [<variant> <file.rsp> ...]
+
+#define MAX_MESSAGE_BYTES 4096
+
+typedef struct {
+	int count;
+	unsigned char seed[48];
+	unsigned long long mlen;
+	unsigned char msg[MAX_MESSAGE_BYTES];
+	unsigned char pk[DEFIV2_PUBLICKEYBYTES];
+	unsigned char sk[DEFIV2_SECRETKEYBYTES];
+	unsigned long long smlen;
+	unsigned char sm[MAX_MESSAGE_BYTES + DEFIV2_BYTES];
+} kat_vector;
+
+// decodes exactly bytes bytes of hex, written as "00" when there are none; returns 0 if the value is malformed
+static int parse_hex(const char* hex, unsigned char* out, unsigned long long bytes)
+{
+	if(bytes == 0)
+		return strcmp(hex, "00") == 0;
+
+	if(strlen(hex) != 2*bytes)
+		return 0;
+
+	for(unsigned long long i=0; i<bytes; i++)
+		if(sscanf(hex + 2*i, "%2hhx", &out[i]) != 1)
+			return 0;
+
+	return 1;
+}
+
+// returns the value of the field name of the line, or NULL if the line is another field
+static const char* field(const char* line, const char* name)
+{
+	size_t len = strlen(name);
+
+	if(strncmp(line, name, len) != 0 || strncmp(line + len, " = ", 3) != 0)
+		return NULL;
+
+	return line + len + 3;
+}
+
+// reads the next vector; returns 0 at the end of the file and -1 if the vector is malformed
+static int read_vector(FILE* fp, kat_vector* v)
+{
+	char* line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	int fields = 0;
+	int ok = 1;
+
+	while(fields < 8 && (len = getline(&line, &size, fp)) >= 0)
+	{
+		const char* value;
+
+		while(len > 0 && (line[len-1] == '\n' || line[len-1] == '\r'))
+			line[--len] = '\0';
+
+		if(len == 0 || line[0] == '#')
+			continue;
+
+		if((value = field(line, "count")) != NULL)
+			v->count = atoi(value);
+		else if((value = field(line, "seed")) != NULL)
+			ok &= parse_hex(value, v->seed, 48);
+		else if((value = field(line, "mlen")) != NULL)
+			ok &= (v->mlen = strtoull(value, NULL, 10)) <= MAX_MESSAGE_BYTES;
+		else if((value = field(line, "msg")) != NULL)
+			ok &= parse_hex(value, v->msg, v->mlen);
+		else if((value = field(line, "pk")) != NULL)
+			ok &= parse_hex(value, v->pk, DEFIV2_PUBLICKEYBYTES);
+		else if((value = field(line, "sk")) != NULL)
+			ok &= parse_hex(value, v->sk, DEFIV2_SECRETKEYBYTES);
+		else if((value = field(line, "smlen")) != NULL)
+			ok &= (v->smlen = strtoull(value, NULL, 10)) <= v->mlen + DEFIV2_BYTES;
+		else if((value = field(line, "sm")) != NULL)
+			ok &= parse_hex(value, v->sm, v->smlen);
+		else
+			ok = 0;
+
+		fields++;
+	}
+
+	free(line);
+
+	if(fields == 0)
+		return 0;
+
+	return fields == 8 && ok ? 1 : -1;
+}
+
+// regenerates a vector as PQCgenKAT_sign does, from randombytes seeded with its seed; returns NULL or the first step that differs
+static const char* check_vector(const defiv2_scheme* scheme, const kat_vector* v)
+{
+	static unsigned char sm[MAX_MESSAGE_BYTES + DEFIV2_BYTES];
+	static unsigned char m[MAX_MESSAGE_BYTES + DEFIV2_BYTES];
+	unsigned char pk[DEFIV2_PUBLICKEYBYTES];
+	unsigned char sk[DEFIV2_SECRETKEYBYTES];
+	unsigned char seed[48];
+	unsigned long long smlen, mlen;
+
+	memcpy(seed, v->seed, 48);
+	defiv2_randombytes_init(seed, NULL, 256);
+
+	if(scheme->keypair(pk, sk) != 0 || memcmp(pk, v->pk, DEFIV2_PUBLICKEYBYTES) != 0)
+		return "pk";
+
+	if(memcmp(sk, v->sk, DEFIV2_SECRETKEYBYTES) != 0)
+		return "sk";
+
+	if(scheme->sign(sm, &smlen, v->msg, v->mlen, sk) != 0 || smlen != v->smlen || memcmp(sm, v->sm, smlen) != 0)
+		return "sm";
+
+	if(scheme->open(m, &mlen, sm, smlen, pk) != 0 || mlen != v->mlen || memcmp(m, v->msg, mlen) != 0)
+		return "open";
+
+	return NULL;
+}
+
+static int check_file(const defiv2_scheme* scheme, const char* file)
+{
+	static kat_vector v;
+	int vectors = 0, failures = 0, ret;
+	FILE* fp = fopen(file, "r");
+
+	if(fp == NULL)
+	{
+		printf("Couldn't open <%s> for read\n", file);
+		return 1;
+	}
+
+	while((ret = read_vector(fp, &v)) > 0)
+	{
+		const char* error = check_vector(scheme, &v);
+
+		if(error != NULL)
+		{
+			printf("%s: count = %d: %s does not match\n", scheme->name, v.count, error);
+			failures++;
+		}
+
+		vectors++;
+	}
+
+	fclose(fp);
+
+	if(ret < 0)
+	{
+		printf("%s: malformed vector after count = %d in <%s>\n", scheme->name, v.count, file);
+		return 1;
+	}
+
+	printf("%s: %s: %d vectors, %d failed\n", scheme->name, file, vectors, failures);
+
+	return vectors == 0 || failures != 0;
+}
+
+// signs and opens a message under a keypair of the pool with every variant
+static int check_pool(void)
+{
+	unsigned char pk[DEFIV2_PUBLICKEYBYTES], sk[DEFIV2_SECRETKEYBYTES];
+	unsigned char m[32] = "defiv2 keypair pool";
+	unsigned char sm[sizeof(m) + DEFIV2_BYTES], m1[sizeof(m) + DEFIV2_BYTES];
+	unsigned long long smlen, mlen;
+	defiv2_keypair_pool_stats stats;
+	int failures = 0;
+
+	defiv2_keypair_pool* pool = defiv2_keypair_pool_create(2, 1);
+
+	if(pool == NULL || defiv2_keypair_pool_take(pool, pk, sk) != 0)
+	{
+		printf("defiv2_keypair_pool: no keypair\n");
+		return 1;
+	}
+
+	for(int v=0; v<DEFIV2_VARIANTS; v++)
+	{
+		const defiv2_scheme* scheme = defiv2_scheme_get(v);
+
+		if(scheme->sign(sm, &smlen, m, sizeof(m), sk) != 0 || scheme->open(m1, &mlen, sm, smlen, pk) != 0)
+		{
+			printf("%s: keypair of the pool does not sign and open\n", scheme->name);
+			failures++;
+		}
+	}
+
+	defiv2_keypair_pool_get_stats(pool, &stats);
+	defiv2_keypair_pool_destroy(pool);
+
+	printf("defiv2_keypair_pool: %llu hits, %llu misses, %d failed\n", stats.hits, stats.misses, failures);
+
+	return failures != 0 || stats.hits + stats.misses != 1;
+}
+
+// counts the phases reported to the profiling callback
+static void count_phase(defiv2_profile_phase phase, unsigned long long cycles, void* arg)
+{
+	__atomic_fetch_add((unsigned long long*)arg, 1, __ATOMIC_RELAXED);
+}
+
+// selects kernels, and signs with every variant while statistics and the profiling callback are on; the counts must
+// match the signatures made, and the phases reported to the callback those of the snapshot (none without make PROFILE=1)
+static int check_telemetry(void)
+{
+	unsigned char pk[DEFIV2_PUBLICKEYBYTES], sk[DEFIV2_SECRETKEYBYTES];
+	unsigned char m[32] = "defiv2 telemetry";
+	unsigned char sm[sizeof(m) + DEFIV2_BYTES];
+	unsigned long long smlen, reported = 0, calls = 0;
+	defiv2_stats stats;
+	defiv2_profile_data profile;
+	int failures = 0;
+
+	if(defiv2_select("pack=portable") != 0 || strcmp(defiv2_selected("pack"), "portable") != 0 || defiv2_select("pack=auto") != 0)
+	{
+		printf("defiv2_select: pack=portable not selected\n");
+		failures++;
+	}
+
+	if(defiv2_select("unknown=portable") != -1 || defiv2_selected("unknown") != NULL)
+	{
+		printf("defiv2_select: unknown kernel accepted\n");
+		failures++;
+	}
+
+	defiv2_scheme_get(DEFIV2_1A)->keypair(pk, sk);
+
+	defiv2_stats_reset();
+	defiv2_stats_enable(1);
+	defiv2_profile_reset();
+	defiv2_profile_set_callback(count_phase, &reported);
+
+	for(int v=0; v<DEFIV2_VARIANTS; v++)
+		defiv2_scheme_get(v)->sign(sm, &smlen, m, sizeof(m), sk);
+
+	defiv2_profile_set_callback(NULL, NULL);
+	defiv2_stats_enable(0);
+	defiv2_stats_snapshot(&stats);
+	defiv2_profile_snapshot(&profile);
+
+	for(int p=0; p<DEFIV2_PROFILE_PHASES; p++)
+		calls += profile.calls[p];
+
+	if(stats.ops[DEFIV2_STATS_SIGN].operations != DEFIV2_VARIANTS || stats.ops[DEFIV2_STATS_SIGN].attempts < DEFIV2_VARIANTS)
+	{
+		printf("defiv2_stats: %llu signatures counted\n", stats.ops[DEFIV2_STATS_SIGN].operations);
+		failures++;
+	}
+
+	if(calls != reported || strcmp(defiv2_profile_phase_name(DEFIV2_PROFILE_PACK), "pack") != 0)
+	{
+		printf("defiv2_profile: %llu phases in the snapshot, %llu reported\n", calls, reported);
+		failures++;
+	}
+
+	printf("defiv2_stats: %llu signatures, %llu candidates; defiv2_profile: %llu phases; %d failed\n",
+		stats.ops[DEFIV2_STATS_SIGN].operations, stats.ops[DEFIV2_STATS_SIGN].attempts, calls, failures);
+
+	return failures != 0;
+}
+
+int main(int argc, char** argv)
+{
+	int failed = 0;
+
+	if(argc < 3 || argc % 2 == 0)
+	{
+		printf("usage: %s <variant> <file.rsp> [<variant> <file.rsp> ...]\n", argv[0]);
+		return 1;
+	}
+
+	for(int i=1; i+1<argc; i+=2)
+	{
+		const defiv2_scheme* scheme = defiv2_scheme_find(argv[i]);
+
+		if(scheme == NULL)
+		{
+			printf("unknown variant <%s>\n", argv[i]);
+			return 1;
+		}
+
+		failed |= check_file(scheme, argv[i+1]);
+	}
+
+	failed |= check_pool();
+	failed |= check_telemetry();
+
+	return failed;
+}
@@ -0,0 +1,207 @@
+#include <stddef.h>
+#include <string.h>
+#include <ctype.h>
+#include "rng.h"
+#include "aes.h"
+#include "pack_functions.h"
+#include "lht_functions.h"
+#include "shake_functions.h"
+#include "keypool_functions.h"
+#include "stats_functions.h"
+#include "profile_functions.h"
+#include "defiv2.h"
+
+// the types of defiv2.h mirror those of the core; a mismatch makes the array size negative
+typedef char defiv2_mirror_check[DEFIV2_REJECT_KINDS == REJECT_KINDS && DEFIV2_STATS_OPS == STATS_OPS &&
+	DEFIV2_STATS_HISTOGRAM_BINS == STATS_HISTOGRAM_BINS && DEFIV2_PROFILE_PHASES == PROFILE_PHASES ? 1 : -1];
+
+#define DEFIV2_SCHEME(prefix, label, id) \
+	{label, id, DEFIV2_PUBLICKEYBYTES, DEFIV2_SECRETKEYBYTES, DEFIV2_BYTES, \
+	 prefix##crypto_sign_keypair, prefix##crypto_sign_keypair_seeded, prefix##crypto_sign_keypair_parallel, \
+	 prefix##crypto_sign_keypair_batch, prefix##crypto_sign, prefix##crypto_sign_parallel, prefix##crypto_sign_bounded, \
+	 prefix##crypto_sign_batch, prefix##crypto_sign_cosign, prefix##crypto_sign_open, prefix##crypto_sign_open_batch, prefix##crypto_sign_cosign_open}
+
+static const defiv2_scheme SCHEMES[DEFIV2_VARIANTS] = {
+	DEFIV2_SCHEME(defiv2_1a_, "DEFIv2-1a", DEFIV2_1A),
+	DEFIV2_SCHEME(defiv2_1b_, "DEFIv2-1b", DEFIV2_1B)
+};
+
+const defiv2_scheme* defiv2_scheme_get(defiv2_variant variant)
+{
+	if(variant < 0 || variant >= DEFIV2_VARIANTS)
+		return NULL;
+
+	return &SCHEMES[variant];
+}
+
+// compares ignoring case
+static int same_name(const char* a, const char* b)
+{
+	for(; *a && *b; a++, b++)
+		if(tolower((unsigned char)*a) != tolower((unsigned char)*b))
+			return 0;
+
+	return *a == *b;
+}
+
+const defiv2_scheme* defiv2_scheme_find(const char* name)
+{
+	for(int v=0; v<DEFIV2_VARIANTS; v++)
+		if(same_name(name, SCHEMES[v].name) || same_name(name, SCHEMES[v].name + 7))
+			return &SCHEMES[v];
+
+	return NULL;
+}
+
+void defiv2_randombytes_init(unsigned char *entropy_input, unsigned char *personalization_string, int security_strength)
+{
+	randombytes_init(entropy_input, personalization_string, security_strength);
+}
+
+int defiv2_randombytes(unsigned char *x, unsigned long long xlen)
+{
+	return randombytes(x, xlen);
+}
+
+defiv2_keypair_pool* defiv2_keypair_pool_create(int depth, int threads)
+{
+	return (defiv2_keypair_pool*)keypair_pool_create(depth, threads);
+}
+
+int defiv2_keypair_pool_take(defiv2_keypair_pool* pool, unsigned char *pk, unsigned char *sk)
+{
+	return keypair_pool_take((keypair_pool*)pool, pk, sk);
+}
+
+void defiv2_keypair_pool_get_stats(defiv2_keypair_pool* pool, defiv2_keypair_pool_stats* stats)
+{
+	keypair_pool_stats s;
+	keypair_pool_get_stats((keypair_pool*)pool, &s);
+	
+	stats->hits = s.hits;
+	stats->misses = s.misses;
+	stats->refills = s.refills;
+	stats->lag_total_ns = s.lag_total_ns;
+	stats->lag_max_ns = s.lag_max_ns;
+	stats->available = s.available;
+}
+
+void defiv2_keypair_pool_destroy(defiv2_keypair_pool* pool)
+{
+	keypair_pool_destroy((keypair_pool*)pool);
+}
+
+void defiv2_stats_enable(int on)
+{
+	stats_enable(on != 0);
+}
+
+int defiv2_stats_enabled(void)
+{
+	return stats_enabled();
+}
+
+void defiv2_stats_snapshot(defiv2_stats* stats)
+{
+	defi_stats s;
+	stats_snapshot(&s);
+	
+	for(int op=0; op<STATS_OPS; op++)
+	{
+		stats->ops[op].operations = s.ops[op].operations;
+		stats->ops[op].attempts = s.ops[op].attempts;
+		stats->ops[op].total_ns = s.ops[op].total_ns;
+		stats->ops[op].rejected_ns = s.ops[op].rejected_ns;
+		
+		for(int a=0; a<STATS_HISTOGRAM_BINS; a++)
+			stats->ops[op].histogram[a] = s.ops[op].histogram[a];
+	}
+	
+	for(int k=0; k<REJECT_KINDS; k++)
+		stats->rejects[k] = s.rejects[k];
+}
+
+void defiv2_stats_reset(void)
+{
+	stats_reset();
+}
+
+const char* defiv2_profile_phase_name(defiv2_profile_phase phase)
+{
+	return profile_phase_name((profile_phase)phase);
+}
+
+void defiv2_profile_snapshot(defiv2_profile_data* data)
+{
+	profile_data d;
+	profile_snapshot(&d);
+	
+	for(int p=0; p<PROFILE_PHASES; p++)
+	{
+		data->cycles[p] = d.cycles[p];
+		data->calls[p] = d.calls[p];
+	}
+}
+
+void defiv2_profile_reset(void)
+{
+	profile_reset();
+}
+
+// the callback set by defiv2_profile_set_callback, to which profile_listener_call passes the phases of the core
+static struct {
+	defiv2_profile_callback callback;
+	void* arg;
+} profile_listener;
+
+static void profile_listener_call(profile_phase phase, unsigned long long cycles, void* arg)
+{
+	profile_listener.callback((defiv2_profile_phase)phase, cycles, profile_listener.arg);
+}
+
+void defiv2_profile_set_callback(defiv2_profile_callback callback, void* arg)
+{
+	if(callback == NULL)
+	{
+		profile_set_callback(NULL, NULL);
+		return;
+	}
+	
+	profile_listener.callback = callback;
+	profile_listener.arg = arg;
+	profile_set_callback(profile_listener_call, NULL);
+}
+
+int defiv2_select(const char* choice)
+{
+	const char* name = strchr(choice, '=');
+	
+	if(name == NULL)
+		return -1;
+	name++;
+	
+	if(strncmp(choice, "aes=", 4) == 0)
+		return aes256_select(name);
+	if(strncmp(choice, "pack=", 5) == 0)
+		return pack_select(name);
+	if(strncmp(choice, "lht=", 4) == 0)
+		return lht_select(name);
+	if(strncmp(choice, "shake=", 6) == 0)
+		return shake_select(name);
+	
+	return -1;
+}
+
+const char* defiv2_selected(const char* kernel)
+{
+	if(strcmp(kernel, "aes") == 0)
+		return aes256_selected();
+	if(strcmp(kernel, "pack") == 0)
+		return pack_selected();
+	if(strcmp(kernel, "lht") == 0)
+		return lht_selected();
+	if(strcmp(kernel, "shake") == 0)
+		return shake_selected();
+	
+	return NULL;
+}